@@ -0,0 +1,153 @@
+// World boxes around transformed models (Aabb.h): what the per-frame pickup
+// test paid with BoundingBox::getBoundary against Arvo's method, one box at a
+// time and four at a time, all filling the arrays the sweep tests read.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "Aabb.h"
+
+static const int BOXES = 1024;
+
+struct Crowd {
+	std::vector<glm::mat4> transforms;
+	std::vector<std::vector<glm::vec3>> vertices; // Model::boxVertices, the six extreme vertices
+	std::vector<Aabb> local;
+};
+
+static Crowd MakeCrowd() {
+	std::mt19937 rng(21);
+	std::uniform_real_distribution<float> pos(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.05f, 1.0f);
+	Crowd s;
+	for (int i = 0; i < BOXES; i++) {
+		glm::vec3 axis(unit(rng), unit(rng), unit(rng));
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(pos(rng), pos(rng), pos(rng)));
+		m = glm::rotate(m, 3.14159f * unit(rng), glm::normalize(axis + glm::vec3(0.0f, 0.01f, 0.0f)));
+		m = glm::scale(m, glm::vec3(size(rng)));
+		s.transforms.push_back(m);
+		glm::vec3 c(unit(rng), unit(rng), unit(rng));
+		glm::vec3 e(size(rng), size(rng), size(rng));
+		s.vertices.push_back({
+			c + glm::vec3(e.x, unit(rng) * e.y, unit(rng) * e.z), c - glm::vec3(e.x, unit(rng) * e.y, unit(rng) * e.z),
+			c + glm::vec3(unit(rng) * e.x, e.y, unit(rng) * e.z), c - glm::vec3(unit(rng) * e.x, e.y, unit(rng) * e.z),
+			c + glm::vec3(unit(rng) * e.x, unit(rng) * e.y, e.z), c - glm::vec3(unit(rng) * e.x, unit(rng) * e.y, e.z),
+		});
+		s.local.push_back(BoundsOf(s.vertices.back()));
+	}
+	return s;
+}
+
+// BoundingBox::getBoundary as it was: a vector of transformed vertices and a
+// vector of six floats per call
+static std::vector<float> LegacyBoundary(const glm::mat4& toWorld, const std::vector<glm::vec3>& vertices) {
+	std::vector<glm::vec3> new_pos;
+	std::vector<float> boundary;
+	float minX = 999999.9f, minY = 999999.9f, minZ = 999999.9f;
+	float maxX = -999999.9f, maxY = -999999.9f, maxZ = -999999.9f;
+	for (size_t i = 0; i < vertices.size(); i++) {
+		glm::vec3 newpos = glm::mat3(toWorld) * vertices[i];
+		newpos = newpos + glm::vec3(toWorld[3][0], toWorld[3][1], toWorld[3][2]);
+		new_pos.push_back(newpos);
+		if (newpos.x < minX) minX = newpos.x;
+		if (newpos.y < minY) minY = newpos.y;
+		if (newpos.z < minZ) minZ = newpos.z;
+		if (newpos.x > maxX) maxX = newpos.x;
+		if (newpos.y > maxY) maxY = newpos.y;
+		if (newpos.z > maxZ) maxZ = newpos.z;
+	}
+	boundary.push_back(maxX);
+	boundary.push_back(minX);
+	boundary.push_back(maxY);
+	boundary.push_back(minY);
+	boundary.push_back(maxZ);
+	boundary.push_back(minZ);
+	return boundary;
+}
+
+// The same six vertices without the allocations, as DuelSim did it before
+static Aabb VertexBounds(const glm::mat4& toWorld, const std::vector<glm::vec3>& vertices) {
+	glm::mat3 linear(toWorld);
+	glm::vec3 offset(toWorld[3]);
+	Aabb box = { glm::vec3(INFINITY), glm::vec3(-INFINITY) };
+	for (const glm::vec3& v : vertices) {
+		glm::vec3 p = linear * v + offset;
+		box.lo = glm::min(box.lo, p);
+		box.hi = glm::max(box.hi, p);
+	}
+	return box;
+}
+
+// The world box through all eight corners of the local box, which Arvo's
+// method should give without visiting them
+static Aabb CornerBounds(const glm::mat4& toWorld, const Aabb& local) {
+	Aabb box = { glm::vec3(INFINITY), glm::vec3(-INFINITY) };
+	for (int c = 0; c < 8; c++) {
+		glm::vec3 v((c & 1) ? local.hi.x : local.lo.x, (c & 2) ? local.hi.y : local.lo.y, (c & 4) ? local.hi.z : local.lo.z);
+		glm::vec3 p = glm::vec3(toWorld * glm::vec4(v, 1.0f));
+		box.lo = glm::min(box.lo, p);
+		box.hi = glm::max(box.hi, p);
+	}
+	return box;
+}
+
+static void Store(AabbSoA& out, size_t i, const Aabb& box) {
+	out.loX[i] = box.lo.x;
+	out.loY[i] = box.lo.y;
+	out.loZ[i] = box.lo.z;
+	out.hiX[i] = box.hi.x;
+	out.hiY[i] = box.hi.y;
+	out.hiZ[i] = box.hi.z;
+}
+
+static bool Near(const glm::vec3& a, const glm::vec3& b) {
+	glm::vec3 d = glm::abs(a - b);
+	return d.x < 1e-4f && d.y < 1e-4f && d.z < 1e-4f;
+}
+
+void BenchAabb() {
+	Crowd s = MakeCrowd();
+
+	size_t corners = 0, batchOff = 0;
+	AabbSoA batch;
+	TransformAabbs(s.transforms.data(), s.local.data(), BOXES, batch);
+	for (int i = 0; i < BOXES; i++) {
+		Aabb arvo = TransformAabb(s.transforms[i], s.local[i]);
+		Aabb exact = CornerBounds(s.transforms[i], s.local[i]);
+		corners += !Near(arvo.lo, exact.lo) || !Near(arvo.hi, exact.hi);
+		batchOff += batch.loX[i] != arvo.lo.x || batch.loY[i] != arvo.lo.y || batch.loZ[i] != arvo.lo.z
+			|| batch.hiX[i] != arvo.hi.x || batch.hiY[i] != arvo.hi.y || batch.hiZ[i] != arvo.hi.z;
+	}
+	Report("Arvo off the eight corner bounds", (double)corners, "boxes");
+	Report("batch off one at a time", (double)batchOff, "boxes");
+
+	// every variant fills the same arrays, the way the sweep tests want them
+	AabbSoA out;
+	out.resize(BOXES);
+	Report("getBoundary", NsPerOp(200, [&](uint64_t) {
+		for (int i = 0; i < BOXES; i++) {
+			std::vector<float> b = LegacyBoundary(s.transforms[i], s.vertices[i]);
+			Store(out, i, { glm::vec3(b[1], b[3], b[5]), glm::vec3(b[0], b[2], b[4]) });
+		}
+		Consume(out.hiX[BOXES - 1] > 0.0f);
+	}) / BOXES, "ns/box");
+	Report("six vertices, no allocation", NsPerOp(200, [&](uint64_t) {
+		for (int i = 0; i < BOXES; i++)
+			Store(out, i, VertexBounds(s.transforms[i], s.vertices[i]));
+		Consume(out.hiX[BOXES - 1] > 0.0f);
+	}) / BOXES, "ns/box");
+	Report("Arvo, one box at a time", NsPerOp(200, [&](uint64_t) {
+		for (int i = 0; i < BOXES; i++)
+			Store(out, i, TransformAabb(s.transforms[i], s.local[i]));
+		Consume(out.hiX[BOXES - 1] > 0.0f);
+	}) / BOXES, "ns/box");
+	Report("Arvo, batch", NsPerOp(200, [&](uint64_t) {
+		TransformAabbs(s.transforms.data(), s.local.data(), BOXES, out);
+		Consume(out.hiX[BOXES - 1] > 0.0f);
+	}) / BOXES, "ns/box");
+}
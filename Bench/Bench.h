@@ -0,0 +1,63 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Tiny helpers shared by the microbenchmarks. Every benchmark is a plain
+// function registered in main.cpp and picked by name on the command line.
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Keeps the optimizer from dropping work whose result is otherwise unused
+extern volatile uint64_t benchSink;
+
+inline void Consume(uint64_t v) {
+	benchSink = benchSink + v;
+}
+
+// Average nanoseconds per call of fn over the given number of iterations,
+// after a short warm-up.
+template <typename F>
+double NsPerOp(uint64_t iterations, F fn) {
+	for (uint64_t i = 0; i < iterations / 10 + 1; i++)
+		fn(i);
+	auto begin = BenchClock::now();
+	for (uint64_t i = 0; i < iterations; i++)
+		fn(i);
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - begin).count();
+	return (double)ns / (double)iterations;
+}
+
+inline void Report(const std::string& name, double value, const char* unit) {
+	std::cout << "  " << name << ": " << value << " " << unit << std::endl;
+}
+
+// Set from the command line in main.cpp
+struct BenchOptions {
+	const char* replay; // --replay: the match "sim" steps, nullptr for the checked-in one
+	bool record;        // --record: rewrite the golden hashes instead of checking them
+};
+extern BenchOptions benchOptions;
+
+// Checks that fail make Bench exit with 1, so a CI run catches them
+extern int benchFailures;
+
+inline void Fail(const std::string& what) {
+	std::cerr << "  FAILED: " << what << std::endl;
+	benchFailures++;
+}
+
+// benchmarks
+void BenchCodec();
+void BenchReplay();
+void BenchSim();
+void BenchSweep();
+void BenchAabb();
+void BenchBroadphase();
+void BenchBvh();
+void BenchObb();
+
+#endif
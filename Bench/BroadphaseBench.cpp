@@ -0,0 +1,118 @@
+// Broad phase (AabbTree.h): 10k boxes wandering about a room, refitted and
+// paired every tick, against testing every box with every other.
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Bench.h"
+#include "AabbTree.h"
+
+static const int BOXES = 10000;
+static const float ROOM = 60.0f;       // metres along each side
+static const float SPEED = 0.05f;      // metres a box may cover per step
+static const int TICKS = 200;
+
+struct Mover {
+	glm::vec3 pos;
+	glm::vec3 velocity;
+	glm::vec3 half;
+};
+
+static std::vector<Mover> MakeMovers() {
+	std::mt19937 rng(22);
+	std::uniform_real_distribution<float> pos(0.0f, ROOM);
+	std::uniform_real_distribution<float> vel(-SPEED, SPEED);
+	std::uniform_real_distribution<float> half(0.1f, 0.5f);
+	std::vector<Mover> movers;
+	for (int i = 0; i < BOXES; i++)
+		movers.push_back({ glm::vec3(pos(rng), pos(rng), pos(rng)), glm::vec3(vel(rng), vel(rng), vel(rng)), glm::vec3(half(rng), half(rng), half(rng)) });
+	return movers;
+}
+
+// one step, bouncing off the walls
+static void Advance(std::vector<Mover>& movers) {
+	for (Mover& m : movers) {
+		m.pos += m.velocity;
+		for (int axis = 0; axis < 3; axis++) {
+			if (m.pos[axis] < 0.0f || m.pos[axis] > ROOM)
+				m.velocity[axis] = -m.velocity[axis];
+		}
+	}
+}
+
+static Aabb BoxOf(const Mover& m) {
+	return { m.pos - m.half, m.pos + m.half };
+}
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> PairList;
+
+static void EveryPair(const std::vector<Mover>& movers, PairList& pairs) {
+	for (size_t i = 0; i < movers.size(); i++) {
+		Aabb a = BoxOf(movers[i]);
+		for (size_t j = i + 1; j < movers.size(); j++) {
+			if (Overlaps(a, BoxOf(movers[j])))
+				pairs.push_back({ (uint32_t)i, (uint32_t)j });
+		}
+	}
+}
+
+static void Sorted(PairList& pairs) {
+	for (auto& p : pairs) {
+		if (p.first > p.second)
+			std::swap(p.first, p.second);
+	}
+	std::sort(pairs.begin(), pairs.end());
+}
+
+void BenchBroadphase() {
+	std::vector<Mover> movers = MakeMovers();
+	AabbTree tree;
+	std::vector<int> proxies;
+	auto build = BenchClock::now();
+	for (int i = 0; i < BOXES; i++)
+		proxies.push_back(tree.insert(BoxOf(movers[i]), (uint32_t)i));
+	Report("build", std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - build).count() / (double)BOXES, "ns/box");
+	Report("tree height", tree.height(), "levels");
+
+	PairList pairs;
+	AabbTree::PairHandler collect = [&](uint32_t a, uint32_t b) { pairs.push_back({ a, b }); };
+	size_t reinserted = 0, found = 0;
+	double moveNs = 0, pairNs = 0;
+	for (int t = 0; t < TICKS; t++) {
+		Advance(movers);
+		auto begin = BenchClock::now();
+		for (int i = 0; i < BOXES; i++)
+			reinserted += tree.move(proxies[i], BoxOf(movers[i]));
+		auto moved = BenchClock::now();
+		pairs.clear();
+		tree.pairs(collect);
+		auto paired = BenchClock::now();
+		moveNs += std::chrono::duration_cast<std::chrono::nanoseconds>(moved - begin).count();
+		pairNs += std::chrono::duration_cast<std::chrono::nanoseconds>(paired - moved).count();
+		found += pairs.size();
+	}
+	Report("overlapping pairs", found / (double)TICKS, "per tick");
+	Report("reinserted", 100.0 * reinserted / ((double)TICKS * BOXES), "% of moves");
+	Report("tree height after", tree.height(), "levels");
+	Report("refit", moveNs / TICKS / 1e6, "ms/tick");
+	Report("pairs", pairNs / TICKS / 1e6, "ms/tick");
+
+	// the last tick's pairs, all of them and nothing else
+	PairList every;
+	auto begin = BenchClock::now();
+	EveryPair(movers, every);
+	double everyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - begin).count() / 1e6;
+	Sorted(pairs);
+	Report("pairs missing or extra against every pair", (double)(pairs != every), "ticks");
+	Report("every box against every other", everyMs, "ms/tick");
+
+	// add and remove churn, like bullets coming and going
+	Report("remove + insert", NsPerOp(100000, [&](uint64_t i) {
+		int k = (int)(i % BOXES);
+		tree.remove(proxies[k]);
+		proxies[k] = tree.insert(BoxOf(movers[k]), (uint32_t)k);
+	}), "ns");
+	Consume(tree.size());
+}
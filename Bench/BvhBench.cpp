@@ -0,0 +1,109 @@
+// Mesh hit tests (MeshBvh.h) on nanosuit.obj: how long the tree takes to build
+// at load time and what a ray or a bullet's step costs against it, checked
+// against every triangle in turn.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "MeshBvh.h"
+#include "ObjMesh.h"
+
+static const char* const PATHS[] = {
+	"../Minimal/model/nanosuit/nanosuit.obj", // from the Bench project directory
+	"Minimal/model/nanosuit/nanosuit.obj",    // from the solution directory
+};
+static const int RAYS = 4096;
+static const int CHECKED = 1024;
+
+// the same test as MeshBvh::raycast, on every triangle
+static bool EveryTriangle(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+	const glm::vec3& origin, const glm::vec3& dir, float maxT, MeshHit& hit) {
+	bool found = false;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		glm::vec3 v0 = positions[indices[i]];
+		glm::vec3 e1 = positions[indices[i + 1]] - v0, e2 = positions[indices[i + 2]] - v0;
+		glm::vec3 p = glm::cross(dir, e2);
+		float det = glm::dot(e1, p);
+		if (std::fabs(det) < 1e-12f)
+			continue;
+		float invDet = 1.0f / det;
+		glm::vec3 s = origin - v0;
+		float u = glm::dot(s, p) * invDet;
+		if (u < 0.0f || u > 1.0f)
+			continue;
+		glm::vec3 q = glm::cross(s, e1);
+		float v = glm::dot(dir, q) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+			continue;
+		float t = glm::dot(e2, q) * invDet;
+		if (t >= 0.0f && t <= maxT) {
+			maxT = t;
+			hit = { (uint32_t)(i / 3), t };
+			found = true;
+		}
+	}
+	return found;
+}
+
+void BenchBvh() {
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	bool read = false;
+	for (const char* path : PATHS) {
+		if ((read = ReadObj(path, positions, indices)))
+			break;
+	}
+	if (!read) {
+		std::cout << "  nanosuit.obj not found, skipped" << std::endl;
+		return;
+	}
+	UnitScale(positions);
+	Report("mesh", indices.size() / 3.0, "triangles");
+
+	MeshBvh bvh;
+	auto begin = BenchClock::now();
+	bvh.build(positions, indices);
+	Report("build", std::chrono::duration_cast<std::chrono::microseconds>(BenchClock::now() - begin).count() / 1000.0, "ms");
+	Report("tree", (double)bvh.nodeCount(), "nodes");
+
+	// shots from a couple of metres out at points in the model's box, so
+	// some graze it and some go through
+	std::mt19937 rng(23);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	Aabb box = bvh.bounds();
+	std::vector<glm::vec3> origins, dirs;
+	for (int i = 0; i < RAYS; i++) {
+		glm::vec3 from = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 0.01f)) * 2.0f;
+		glm::vec3 at = (box.lo + box.hi) * 0.5f + (box.hi - box.lo) * 0.5f * glm::vec3(unit(rng), unit(rng), unit(rng));
+		origins.push_back(from);
+		dirs.push_back(glm::normalize(at - from));
+	}
+
+	size_t hits = 0, disagree = 0;
+	for (int i = 0; i < CHECKED; i++) {
+		MeshHit a, b;
+		bool hitTree = bvh.raycast(origins[i], dirs[i], 10.0f, a);
+		bool hitAll = EveryTriangle(positions, indices, origins[i], dirs[i], 10.0f, b);
+		hits += hitTree;
+		disagree += hitTree != hitAll || (hitTree && a.t != b.t);
+	}
+	Report("rays hitting", 100.0 * hits / CHECKED, "%");
+	Report("disagreeing with every triangle", (double)disagree, "rays");
+
+	Report("ray", NsPerOp(RAYS * 20, [&](uint64_t i) {
+		MeshHit hit;
+		Consume(bvh.raycast(origins[i % RAYS], dirs[i % RAYS], 10.0f, hit));
+	}), "ns");
+	// a bullet's step at 180 steps/s and about 100 m/s, ending near the model
+	Report("bullet step", NsPerOp(RAYS * 20, [&](uint64_t i) {
+		glm::vec3 to = origins[i % RAYS] + dirs[i % RAYS] * 2.0f;
+		float toi;
+		Consume(bvh.segment(to - dirs[i % RAYS] * 0.55f, to, toi));
+	}), "ns");
+	Report("ray, every triangle", NsPerOp(200, [&](uint64_t i) {
+		MeshHit hit;
+		Consume(EveryTriangle(positions, indices, origins[i % RAYS], dirs[i % RAYS], 10.0f, hit));
+	}), "ns");
+}
@@ -0,0 +1,184 @@
+// Compares the compact Player encoding of PlayerCodec.h against the MSGPACK_DEFINE_MAP
+// encoding it replaces: bytes per packet, encode/decode cost and quantization error.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "rpc/msgpack.hpp"
+#include "Bench.h"
+// Shared struct
+#include "Player.h"
+#include "PlayerCodec.h"
+#include "Protocol.h"
+#include "SnapshotDelta.h"
+
+static const uint64_t ITERATIONS = 200000;
+static const int SAMPLES = 256;
+static const int SYNC_RATE = 120; // NetworkThread::SEND_RATE
+
+static glm::quat RandomQuat(std::mt19937& rng) {
+	std::normal_distribution<float> n;
+	float c[4] = { n(rng), n(rng), n(rng), n(rng) };
+	float len = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2] + c[3] * c[3]);
+	glm::quat q;
+	q.x = c[0] / len;
+	q.y = c[1] / len;
+	q.z = c[2] / len;
+	q.w = c[3] / len;
+	return q;
+}
+
+// poses inside a room-scale play area
+static std::vector<Player> SamplePlayers() {
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> pos(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> height(0.8f, 2.0f);
+	std::uniform_int_distribution<int> flag(0, 1);
+	std::vector<Player> players(SAMPLES);
+	for (Player& p : players) {
+		p.fire = flag(rng) != 0;
+		p.fired = flag(rng) != 0;
+		p.pickedUp = flag(rng) != 0;
+		p.finishFire = flag(rng) != 0;
+		p.dead = flag(rng) != 0;
+		p.rotation = RandomQuat(rng);
+		p.handrotation = RandomQuat(rng);
+		p.headrotation = RandomQuat(rng);
+		p.handpos = glm::vec3(pos(rng), height(rng), pos(rng));
+		p.headPos = glm::vec3(pos(rng), height(rng), pos(rng));
+		glm::quat d = RandomQuat(rng);
+		p.viewDir = glm::vec3(d.x, d.y, d.z);
+		p.shootDir = glm::vec3(d.y, d.z, d.w);
+	}
+	return players;
+}
+
+// Average sync reply size over a trace of the opponent, full packed against deltas
+// acknowledged every reply. moving picks whether the hand and body move as well as the head.
+static double DeltaReplyBytes(bool moving, bool deltas) {
+	const int TRACE = 1200;
+	std::mt19937 rng(11);
+	std::normal_distribution<float> sway(0.0f, 0.002f);
+	SnapshotRing serverRing, clientRing;
+	SyncReply reply = {};
+	reply.opponent = true;
+	reply.other.headPos = glm::vec3(0.0f, 1.7f, -3.0f);
+	reply.other.handpos = glm::vec3(0.3f, 1.1f, -2.8f);
+	uint32_t ack = 0;
+	size_t bytes = 0;
+	for (int t = 1; t <= TRACE; t++) {
+		reply.tick = t;
+		reply.time = t / 90.0;
+		reply.other.headPos.x += sway(rng);
+		reply.other.headPos.y += sway(rng);
+		if (moving) {
+			reply.other.handpos.x += 10.0f * sway(rng);
+			reply.other.handpos.z += 10.0f * sway(rng);
+			reply.other.rotation.w += sway(rng);
+			reply.other.handrotation.x += 10.0f * sway(rng);
+		}
+		Packet packet = deltas ? PackDeltaSyncReply(reply, ack, serverRing) : PackSyncReply(reply);
+		bytes += packet.size();
+		SyncReply decoded;
+		if (deltas && UnpackDeltaSyncReply(packet, decoded, clientRing))
+			ack = (uint32_t)decoded.tick;
+	}
+	return (double)bytes / TRACE;
+}
+
+static float PositionError(const glm::vec3& a, const glm::vec3& b) {
+	return std::max(std::fabs(a.x - b.x), std::max(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+}
+
+// angle in degrees between two unit quaternions, ignoring the q / -q ambiguity
+static float AngleError(const glm::quat& a, const glm::quat& b) {
+	float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+	return 2.0f * std::acos(std::min(1.0f, dot)) * 57.2957795f;
+}
+
+void BenchCodec() {
+	std::vector<Player> players = SamplePlayers();
+
+	// size of one player
+	clmdep_msgpack::sbuffer mapBuf;
+	clmdep_msgpack::pack(mapBuf, players[0]);
+	Report("player, msgpack map", (double)mapBuf.size(), "bytes");
+	Report("player, packed", (double)PACKED_PLAYER_SIZE, "bytes");
+
+	// size of a sync round trip (request + reply), which is what a client pays per frame
+	SyncReply reply = {};
+	reply.tick = 123456;
+	reply.time = 1371.7;
+	reply.opponent = true;
+	reply.other = players[1];
+	reply.events.push_back({ EVENT_FIRED, 123450 });
+	clmdep_msgpack::sbuffer syncBuf;
+	clmdep_msgpack::pack(syncBuf, std::make_tuple(players[0], (uint64_t)123400));
+	clmdep_msgpack::pack(syncBuf, reply);
+	clmdep_msgpack::sbuffer packedBuf;
+	clmdep_msgpack::pack(packedBuf, std::make_tuple(PackSyncRequest(players[0], 123400)));
+	clmdep_msgpack::pack(packedBuf, PackSyncReply(reply));
+	Report("sync round trip, msgpack map", (double)syncBuf.size(), "bytes");
+	Report("sync round trip, packed", (double)packedBuf.size(), "bytes");
+	Report("bandwidth saving", (double)syncBuf.size() / (double)packedBuf.size(), "x");
+	Report("match at " + std::to_string(SYNC_RATE) + " Hz, msgpack map", 2.0 * SYNC_RATE * syncBuf.size() / 1024.0, "KiB/s");
+	Report("match at " + std::to_string(SYNC_RATE) + " Hz, packed", 2.0 * SYNC_RATE * packedBuf.size() / 1024.0, "KiB/s");
+
+	// deltas against the acknowledged baseline
+	Report("reply, standing opponent, packed", DeltaReplyBytes(false, false), "bytes");
+	Report("reply, standing opponent, delta", DeltaReplyBytes(false, true), "bytes");
+	Report("reply, moving opponent, packed", DeltaReplyBytes(true, false), "bytes");
+	Report("reply, moving opponent, delta", DeltaReplyBytes(true, true), "bytes");
+
+	// encode
+	clmdep_msgpack::sbuffer buf;
+	Report("encode, msgpack map", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		buf.clear();
+		clmdep_msgpack::pack(buf, players[i % SAMPLES]);
+		Consume(buf.size());
+	}), "ns/op");
+	unsigned char packed[PACKED_PLAYER_SIZE];
+	Report("encode, packed", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		PackPlayer(players[i % SAMPLES], packed);
+		Consume(packed[i % PACKED_PLAYER_SIZE]);
+	}), "ns/op");
+
+	// decode
+	std::vector<clmdep_msgpack::sbuffer> mapEncoded(SAMPLES);
+	std::vector<Packet> packedEncoded(SAMPLES, Packet(PACKED_PLAYER_SIZE));
+	for (int i = 0; i < SAMPLES; i++) {
+		clmdep_msgpack::pack(mapEncoded[i], players[i]);
+		PackPlayer(players[i], &packedEncoded[i][0]);
+	}
+	Report("decode, msgpack map", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		const clmdep_msgpack::sbuffer& b = mapEncoded[i % SAMPLES];
+		clmdep_msgpack::object_handle oh = clmdep_msgpack::unpack(b.data(), b.size());
+		Player p = oh.get().as<Player>();
+		Consume(p.fire);
+	}), "ns/op");
+	Report("decode, packed", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		Player p;
+		UnpackPlayer(&packedEncoded[i % SAMPLES][0], p);
+		Consume(p.fire);
+	}), "ns/op");
+
+	// what the compact format gives up
+	float maxPos = 0.0f, maxDir = 0.0f, maxAngle = 0.0f;
+	int flagMismatches = 0;
+	for (int i = 0; i < SAMPLES; i++) {
+		const Player& a = players[i];
+		Player b;
+		UnpackPlayer(&packedEncoded[i][0], b);
+		maxPos = std::max(maxPos, std::max(PositionError(a.handpos, b.handpos), PositionError(a.headPos, b.headPos)));
+		maxDir = std::max(maxDir, std::max(PositionError(a.viewDir, b.viewDir), PositionError(a.shootDir, b.shootDir)));
+		maxAngle = std::max(maxAngle, std::max(AngleError(a.rotation, b.rotation),
+			std::max(AngleError(a.handrotation, b.handrotation), AngleError(a.headrotation, b.headrotation))));
+		flagMismatches += (a.fire != b.fire) + (a.fired != b.fired) + (a.pickedUp != b.pickedUp) + (a.finishFire != b.finishFire) + (a.dead != b.dead);
+	}
+	Report("max position error", maxPos * 1000.0, "mm");
+	Report("max direction error", maxDir, "");
+	Report("max rotation error", maxAngle, "degrees");
+	Report("flag mismatches", flagMismatches, "");
+}
@@ -0,0 +1,110 @@
+// Oriented boxes (Obb.h) against the world Aabbs they would replace in a
+// narrow phase: how many pairs and rays the Aabbs call touching that are not,
+// and what the tighter answer costs per pair.
+
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "Aabb.h"
+#include "Obb.h"
+#include "Sweep.h"
+
+static const int PAIRS = 4096;
+
+struct Placed {
+	glm::mat4 toWorld;
+	Aabb local;
+};
+
+// model sized boxes turned every which way, centres close enough that about
+// half their world Aabbs touch
+static std::vector<Placed> MakeBoxes(int count) {
+	std::mt19937 rng(24);
+	std::uniform_real_distribution<float> pos(-0.4f, 0.4f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.05f, 0.3f);
+	std::vector<Placed> boxes;
+	for (int i = 0; i < count; i++) {
+		glm::vec3 axis(unit(rng), unit(rng), unit(rng));
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(pos(rng), pos(rng), pos(rng)));
+		m = glm::rotate(m, 3.14159f * unit(rng), glm::normalize(axis + glm::vec3(0.0f, 0.01f, 0.0f)));
+		glm::vec3 half(size(rng), size(rng), size(rng));
+		boxes.push_back({ m, { -half, half } });
+	}
+	return boxes;
+}
+
+void BenchObb() {
+	std::vector<Placed> boxes = MakeBoxes(2 * PAIRS);
+	std::vector<Aabb> world;
+	std::vector<Obb> oriented;
+	for (const Placed& p : boxes) {
+		world.push_back(TransformAabb(p.toWorld, p.local));
+		oriented.push_back(OrientedBox(p.toWorld, p.local));
+	}
+
+	size_t aabbHits = 0, obbHits = 0, missed = 0, disagree = 0;
+	for (int i = 0; i < PAIRS; i++) {
+		bool aabb = Overlaps(world[2 * i], world[2 * i + 1]);
+		bool obb = ObbOverlapScalar(oriented[2 * i], oriented[2 * i + 1]);
+		aabbHits += aabb;
+		obbHits += obb;
+		missed += obb && !aabb;
+		disagree += obb != ObbOverlap(oriented[2 * i], oriented[2 * i + 1]);
+	}
+	Report("pairs touching, aabb", 100.0 * aabbHits / PAIRS, "%");
+	Report("pairs touching, obb", 100.0 * obbHits / PAIRS, "%");
+	Report("aabb false positives", aabbHits ? 100.0 * (aabbHits - obbHits) / aabbHits : 0.0, "% of its hits");
+	Report("obb hits the aabb missed", (double)missed, "pairs");
+	Report("sse disagreeing with scalar", (double)disagree, "pairs");
+
+	// bullet steps through the middle of the crowd
+	std::mt19937 rng(124);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> from, to;
+	for (int i = 0; i < PAIRS; i++) {
+		glm::vec3 a(unit(rng), unit(rng), unit(rng)), b(unit(rng), unit(rng), unit(rng));
+		from.push_back(a * 0.6f);
+		to.push_back(b * 0.6f);
+	}
+	size_t aabbRays = 0, obbRays = 0;
+	for (int i = 0; i < PAIRS; i++) {
+		float toi;
+		aabbRays += SweepBox(from[i], to[i], world[i].lo, world[i].hi, toi);
+		obbRays += ObbRay(oriented[i], from[i], to[i] - from[i], 1.0f, toi);
+	}
+	Report("segments hitting, aabb", 100.0 * aabbRays / PAIRS, "%");
+	Report("segments hitting, obb", 100.0 * obbRays / PAIRS, "%");
+
+	Report("aabb, build and test", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		const Placed& a = boxes[2 * (i % PAIRS)];
+		const Placed& b = boxes[2 * (i % PAIRS) + 1];
+		Consume(Overlaps(TransformAabb(a.toWorld, a.local), TransformAabb(b.toWorld, b.local)));
+	}), "ns/pair");
+	Report("obb, build and test", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		const Placed& a = boxes[2 * (i % PAIRS)];
+		const Placed& b = boxes[2 * (i % PAIRS) + 1];
+		Consume(ObbOverlap(OrientedBox(a.toWorld, a.local), OrientedBox(b.toWorld, b.local)));
+	}), "ns/pair");
+	Report("aabb test", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		Consume(Overlaps(world[2 * (i % PAIRS)], world[2 * (i % PAIRS) + 1]));
+	}), "ns/pair");
+	Report("obb test, scalar", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		Consume(ObbOverlapScalar(oriented[2 * (i % PAIRS)], oriented[2 * (i % PAIRS) + 1]));
+	}), "ns/pair");
+	Report("obb test, sse", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		Consume(ObbOverlap(oriented[2 * (i % PAIRS)], oriented[2 * (i % PAIRS) + 1]));
+	}), "ns/pair");
+	Report("segment, aabb", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		float toi;
+		Consume(SweepBox(from[i % PAIRS], to[i % PAIRS], world[i % PAIRS].lo, world[i % PAIRS].hi, toi));
+	}), "ns");
+	Report("segment, obb", NsPerOp(PAIRS * 50, [&](uint64_t i) {
+		float toi;
+		size_t k = i % PAIRS;
+		Consume(ObbRay(oriented[k], from[k], to[k] - from[k], 1.0f, toi));
+	}), "ns");
+}
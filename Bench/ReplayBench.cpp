@@ -0,0 +1,128 @@
+// Cost of the replay format (Replay.h): encoding a tick on the recorder's
+// writer thread, bytes per tick, and random access by tick through the
+// memory-mapped ReplayReader.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+// Shared struct
+#include "Player.h"
+#include "Replay.h"
+#include "ReplayReader.h"
+
+static const uint64_t ITERATIONS = 200000;
+static const uint32_t TICKS = 60 * 60 * 10; // ten minutes at 60 Hz
+static const uint32_t CHUNK_TICKS = 128;    // ReplayRecorder::CHUNK_TICKS
+static const char* FILE_NAME = "bench_replay.wdr";
+
+static ReplayTick SampleTick(uint32_t tick) {
+	ReplayTick t = {};
+	t.tick = tick;
+	t.time = tick / 60.0;
+	for (int i = 0; i < 2; i++) {
+		Player& p = t.players[i];
+		float phase = tick * 0.02f + i;
+		p.pickedUp = true;
+		p.rotation = glm::quat(1, 0, 0, 0);
+		p.handrotation = glm::quat(std::cos(phase), 0, std::sin(phase), 0);
+		p.headrotation = glm::quat(1, 0, 0, 0);
+		p.headPos = glm::vec3(0.1f * std::sin(phase), 1.7f, 2.0f * i);
+		p.handpos = p.headPos + glm::vec3(0.3f, -0.4f, 0.2f);
+		p.viewDir = glm::vec3(0, 0, i ? -1 : 1);
+		p.shootDir = p.viewDir;
+		t.inputSeq[i] = tick;
+	}
+	return t;
+}
+
+// the layout ReplayRecorder writes, without its threads
+static bool WriteReplay(const char* path, uint32_t ticks) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+	unsigned char header[replay::FILE_HEADER_SIZE];
+	PackReplayHeader({ 1, 0 }, header);
+	out.write((const char*)header, sizeof(header));
+	uint64_t offset = sizeof(header);
+
+	std::vector<ReplayChunk> index;
+	std::vector<unsigned char> chunk(replay::CHUNK_HEADER_SIZE + CHUNK_TICKS * REPLAY_RECORD_SIZE);
+	for (uint32_t first = 1; first <= ticks; first += CHUNK_TICKS) {
+		ReplayChunk c = { first, std::min(CHUNK_TICKS, ticks - first + 1), 10.0, offset };
+		PackReplayChunk(c, chunk.data());
+		for (uint32_t i = 0; i < c.count; i++)
+			PackReplayTick(SampleTick(first + i), chunk.data() + replay::CHUNK_HEADER_SIZE + i * REPLAY_RECORD_SIZE);
+		size_t size = replay::CHUNK_HEADER_SIZE + c.count * REPLAY_RECORD_SIZE;
+		out.write((const char*)chunk.data(), size);
+		index.push_back(c);
+		offset += size;
+	}
+
+	std::vector<unsigned char> tail(index.size() * replay::INDEX_ENTRY_SIZE + replay::TRAILER_SIZE);
+	unsigned char* p = tail.data();
+	for (const ReplayChunk& c : index) {
+		codec::put32(p, c.firstTick);
+		codec::put32(p, c.count);
+		replay::put64(p, c.offset);
+	}
+	replay::put64(p, offset);
+	codec::put32(p, (uint32_t)index.size());
+	codec::put32(p, replay::INDEX_MAGIC);
+	out.write((const char*)tail.data(), tail.size());
+	return (bool)out;
+}
+
+void BenchReplay() {
+	std::vector<ReplayTick> ticks;
+	for (uint32_t i = 1; i <= 256; i++)
+		ticks.push_back(SampleTick(i));
+
+	unsigned char record[REPLAY_RECORD_SIZE];
+	Report("record size", (double)REPLAY_RECORD_SIZE, "bytes/tick");
+	Report("match at 60 Hz", 60.0 * REPLAY_RECORD_SIZE / 1024.0, "KiB/s");
+	Report("copy into a chunk (tick thread)", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		static ReplayTick chunk[CHUNK_TICKS];
+		chunk[i % CHUNK_TICKS] = ticks[i % ticks.size()];
+		Consume(chunk[i % CHUNK_TICKS].inputSeq[0]);
+	}), "ns/tick");
+	Report("encode (writer thread)", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		PackReplayTick(ticks[i % ticks.size()], record);
+		Consume(record[i % REPLAY_RECORD_SIZE]);
+	}), "ns/tick");
+
+	if (!WriteReplay(FILE_NAME, TICKS)) {
+		std::cerr << "  cannot write " << FILE_NAME << std::endl;
+		return;
+	}
+	ReplayReader reader;
+	auto begin = BenchClock::now();
+	bool opened = reader.open(FILE_NAME);
+	double openUs = std::chrono::duration<double, std::micro>(BenchClock::now() - begin).count();
+	if (!opened || reader.ticks() != TICKS) {
+		std::cerr << "  cannot read " << FILE_NAME << " back" << std::endl;
+		return;
+	}
+	Report("open, " + std::to_string(TICKS) + " ticks", openUs, "us");
+
+	std::mt19937 rng(3);
+	std::uniform_int_distribution<uint32_t> anyTick(1, TICKS);
+	std::vector<uint32_t> order(4096);
+	for (uint32_t& t : order)
+		t = anyTick(rng);
+	ReplayTick t;
+	Report("read, sequential", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		reader.at(1 + i % TICKS, t);
+		Consume(t.inputSeq[0]);
+	}), "ns/tick");
+	Report("read, random tick", NsPerOp(ITERATIONS, [&](uint64_t i) {
+		reader.at(order[i % order.size()], t);
+		Consume(t.inputSeq[1]);
+	}), "ns/tick");
+	reader.close();
+	std::remove(FILE_NAME);
+}
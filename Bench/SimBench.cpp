@@ -0,0 +1,215 @@
+// Determinism and throughput of the duel rules (DuelSim.h) with no GPU or
+// headset. A match the server recorded (Replay.h) is read back through
+// ReplayReader and stepped as seat 0 saw it. Every tick's state hash is checked
+// against the golden file next to the replay, so a build, compiler or machine
+// that steps the rules differently fails the run. The match is then stepped by
+// a FixedStep clock under headset frame rates, which must all end it in the
+// same state, and timed.
+//
+// The checked-in match is data/duel.wdr, its hashes data/duel.hashes. After a
+// deliberate change to the rules, "Bench --record sim" writes them anew.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+// Shared struct
+#include "Player.h"
+#include "DuelSim.h"
+#include "FixedStep.h"
+#include "Replay.h"
+#include "ReplayReader.h"
+
+static const char* const REPLAYS[] = {
+	"data/duel.wdr",       // from the Bench project directory
+	"Bench/data/duel.wdr", // from the solution directory
+};
+static const int SEAT = 0;
+
+struct TraceTick {
+	DuelInput input;
+	Player opponent; // as sampled that frame, before the rules touch it
+	bool trigger;
+};
+
+// Model::scaleProcess centers every model and scales it to a unit box
+static std::vector<glm::vec3> UnitBox() {
+	return {
+		glm::vec3(0.5f, 0, 0), glm::vec3(-0.5f, 0, 0),
+		glm::vec3(0, 0.5f, 0), glm::vec3(0, -0.5f, 0),
+		glm::vec3(0, 0, 0.5f), glm::vec3(0, 0, -0.5f),
+	};
+}
+
+// the match as SEAT played it; false if a tick is missing from the file
+static bool Trace(const ReplayReader& reader, std::vector<TraceTick>& trace) {
+	double startAt = reader.startAt();
+	ReplayTick t;
+	trace.clear();
+	for (uint64_t tick = reader.firstTick(); tick <= reader.lastTick(); tick++) {
+		if (!reader.at(tick, t))
+			return false;
+		TraceTick step;
+		step.input = ReplayInput(t, SEAT, startAt);
+		step.opponent = t.players[1 - SEAT];
+		step.trigger = t.fired[SEAT];
+		trace.push_back(step);
+	}
+	return true;
+}
+
+static std::string GoldenPath(const std::string& replay) {
+	size_t ext = replay.rfind(".wdr");
+	return (ext == std::string::npos ? replay : replay.substr(0, ext)) + ".hashes";
+}
+
+// one "tick hash" line per tick, the hash in hex
+static bool ReadGolden(const std::string& path, std::vector<uint64_t>& ticks, std::vector<uint64_t>& hashes) {
+	std::ifstream in(path);
+	if (!in)
+		return false;
+	unsigned long long tick;
+	std::string hex;
+	while (in >> tick >> hex) {
+		ticks.push_back(tick);
+		hashes.push_back(std::stoull(hex, nullptr, 16));
+	}
+	return true;
+}
+
+static bool WriteGolden(const std::string& path, uint64_t firstTick, const std::vector<uint64_t>& hashes) {
+	std::ofstream out(path, std::ios::trunc);
+	char line[48];
+	for (size_t i = 0; i < hashes.size(); i++) {
+		snprintf(line, sizeof(line), "%llu %016llx\n", (unsigned long long)(firstTick + i), (unsigned long long)hashes[i]);
+		out << line;
+	}
+	return (bool)out;
+}
+
+static unsigned Step(DuelSim& sim, const TraceTick& t, Player& opponent) {
+	opponent = t.opponent;
+	if (t.trigger)
+		sim.pullTrigger();
+	return sim.step(t.input, opponent);
+}
+
+// one whole match, keeping every tick's hash
+static std::vector<uint64_t> Run(const std::vector<TraceTick>& trace, unsigned& events) {
+	DuelSim sim;
+	sim.setBoxes(UnitBox(), UnitBox());
+	std::vector<uint64_t> hashes(trace.size());
+	Player opponent;
+	events = 0;
+	for (size_t i = 0; i < trace.size(); i++) {
+		events |= Step(sim, trace[i], opponent);
+		hashes[i] = sim.hash(opponent);
+	}
+	return hashes;
+}
+
+// the hashes of a run against the golden file; true if they all match
+static bool CheckGolden(const std::string& path, uint64_t firstTick, const std::vector<uint64_t>& hashes) {
+	std::vector<uint64_t> ticks, golden;
+	if (!ReadGolden(path, ticks, golden)) {
+		Fail("cannot read " + path + "; run with --record to write it");
+		return false;
+	}
+	if (golden.size() != hashes.size()) {
+		Fail(path + " holds " + std::to_string(golden.size()) + " ticks, the replay " + std::to_string(hashes.size()));
+		return false;
+	}
+	size_t mismatches = 0;
+	uint64_t diverged = 0;
+	for (size_t i = 0; i < hashes.size(); i++) {
+		if (ticks[i] == firstTick + i && golden[i] == hashes[i])
+			continue;
+		if (mismatches++ == 0)
+			diverged = firstTick + i;
+	}
+	Report("ticks hashing unlike " + path, (double)mismatches, "ticks");
+	if (mismatches) {
+		Fail("the rules diverge from the golden run at tick " + std::to_string(diverged));
+		return false;
+	}
+	return true;
+}
+
+void BenchSim() {
+	std::string path;
+	if (benchOptions.replay)
+		path = benchOptions.replay;
+	for (const char* candidate : REPLAYS) {
+		if (path.empty() && std::ifstream(candidate))
+			path = candidate;
+	}
+	ReplayReader reader;
+	if (path.empty() || !reader.open(path.c_str()) || reader.ticks() == 0) {
+		Fail("cannot read the replay " + (path.empty() ? std::string(REPLAYS[0]) : path));
+		return;
+	}
+	std::vector<TraceTick> trace;
+	if (!Trace(reader, trace)) {
+		Fail(path + " is missing ticks");
+		return;
+	}
+	uint64_t firstTick = reader.firstTick();
+	reader.close();
+
+	unsigned events;
+	std::vector<uint64_t> hashes = Run(trace, events);
+	if (!(events & DUEL_SHOT) || !(events & DUEL_WON))
+		std::cout << "  the match never fired or never won; it does not exercise all of the rules" << std::endl;
+	char hash[32];
+	snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)hashes.back());
+	std::cout << "  " << path << ", final state hash: " << hash << std::endl;
+	Report("trace", (double)trace.size(), "ticks");
+
+	std::string golden = GoldenPath(path);
+	if (benchOptions.record) {
+		if (WriteGolden(golden, firstTick, hashes))
+			std::cout << "  wrote " << golden << std::endl;
+		else
+			Fail("cannot write " + golden);
+	}
+	else
+		CheckGolden(golden, firstTick, hashes);
+
+	// the trace holds one input per step, so every frame rate has to land on the same state
+	for (int rate : { 72, 90, 120 }) {
+		DuelSim sim;
+		sim.setBoxes(UnitBox(), UnitBox());
+		FixedStep clock(1.0 / DuelSim::STEP_RATE, DuelSim::STEP_RATE / 10);
+		Player opponent;
+		size_t next = 0;
+		uint64_t frames = 0;
+		for (; next < trace.size(); frames++) {
+			int steps = clock.advance((double)frames / rate);
+			for (int i = 0; i < steps && next < trace.size(); i++)
+				Step(sim, trace[next++], opponent);
+		}
+		bool same = sim.hash(opponent) == hashes.back();
+		Report(std::to_string(rate) + " Hz frames, steps per frame", (double)trace.size() / frames, same ? "(same final state)" : "(DIFFERENT final state)");
+		if (!same)
+			Fail(std::to_string(rate) + " Hz frames end the match in another state");
+	}
+
+	const size_t ticks = trace.size();
+	DuelSim sim;
+	sim.setBoxes(UnitBox(), UnitBox());
+	Player opponent;
+	auto loop = [&](uint64_t i) {
+		if (i % ticks == 0)
+			sim.reset();
+		Consume(Step(sim, trace[i % ticks], opponent));
+	};
+	double step = NsPerOp(ticks * 10, loop);
+	Report("step", step, "ns/tick");
+	Report("step", 1e3 / step, "Mticks/s");
+	Report("step + hash", NsPerOp(ticks * 10, [&](uint64_t i) {
+		loop(i);
+		Consume(sim.hash(opponent));
+	}), "ns/tick");
+}
@@ -0,0 +1,113 @@
+// Swept projectile hits (Sweep.h): how many hits an overlap test at the end of
+// each step misses at bullet speeds, and what the SSE batch costs per
+// projectile/target pair against one box at a time.
+
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "Sweep.h"
+
+static const int TARGETS = 64;         // heads and torsos of a full shard of duels
+static const int PROJECTILES = 1024;
+static const int STEPS = 60;           // a third of a second at 180 steps/s
+static const float STRIDE = 1.0f;      // metres a bullet covers per step
+static const float HEAD = 0.3f;        // box edge
+
+struct Field {
+	SweepTargets targets;
+	std::vector<glm::vec3> from, to;   // one step of every projectile
+	std::vector<glm::vec3> start, velocity;
+};
+
+static Field MakeField() {
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> x(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> y(1.2f, 1.9f);
+	std::normal_distribution<float> spread(0.0f, 0.05f);
+	Field f;
+	std::vector<glm::vec3> centres;
+	for (int i = 0; i < TARGETS; i++) {
+		glm::vec3 c(x(rng), y(rng), x(rng));
+		centres.push_back(c);
+		f.targets.add({ c - glm::vec3(HEAD / 2), c + glm::vec3(HEAD / 2) });
+	}
+	// every projectile is aimed at some target, give or take the shooter's aim
+	std::uniform_int_distribution<int> pick(0, TARGETS - 1);
+	for (int i = 0; i < PROJECTILES; i++) {
+		glm::vec3 origin(x(rng), y(rng), x(rng));
+		glm::vec3 aim = centres[pick(rng)] + glm::vec3(spread(rng), spread(rng), spread(rng)) - origin;
+		f.start.push_back(origin);
+		f.velocity.push_back(glm::normalize(aim) * STRIDE);
+		f.from.push_back(origin);
+		f.to.push_back(origin + f.velocity.back());
+	}
+	return f;
+}
+
+static bool Inside(const SweepTargets& t, size_t i, const glm::vec3& p) {
+	return p.x >= t.loX[i] && p.x <= t.hiX[i] && p.y >= t.loY[i] && p.y <= t.hiY[i] && p.z >= t.loZ[i] && p.z <= t.hiZ[i];
+}
+
+// the first box every segment reaches, one box at a time
+static void SweepEach(const Field& f, std::vector<SweepHit>& hits) {
+	for (size_t s = 0; s < f.from.size(); s++) {
+		float best = 2.0f;
+		size_t hit = f.targets.size();
+		for (size_t i = 0; i < f.targets.size(); i++) {
+			float toi;
+			if (SweepBox(f.from[s], f.to[s], glm::vec3(f.targets.loX[i], f.targets.loY[i], f.targets.loZ[i]),
+				glm::vec3(f.targets.hiX[i], f.targets.hiY[i], f.targets.hiZ[i]), toi) && toi < best) {
+				best = toi;
+				hit = i;
+			}
+		}
+		if (hit < f.targets.size())
+			hits.push_back({ (uint32_t)s, (uint32_t)hit, best });
+	}
+}
+
+void BenchSweep() {
+	Field f = MakeField();
+
+	// fly every projectile for STEPS steps and count what each test catches
+	int overlapHits = 0, sweptHits = 0;
+	std::vector<glm::vec3> from(1), to(1);
+	std::vector<SweepHit> hits;
+	for (int p = 0; p < PROJECTILES; p++) {
+		bool overlap = false, swept = false;
+		for (int step = 0; step < STEPS && !swept; step++) {
+			from[0] = f.start[p] + f.velocity[p] * (float)step;
+			to[0] = from[0] + f.velocity[p];
+			for (size_t i = 0; i < f.targets.size() && !overlap; i++)
+				overlap = Inside(f.targets, i, to[0]);
+			hits.clear();
+			SweepBatch(from.data(), to.data(), 1, f.targets, hits);
+			swept = !hits.empty();
+		}
+		overlapHits += overlap;
+		sweptHits += swept;
+	}
+	Report("hits, overlap at each step's end", overlapHits, "projectiles");
+	Report("hits, swept", sweptHits, "projectiles");
+
+	std::vector<SweepHit> batch, each;
+	SweepBatch(f.from.data(), f.to.data(), f.from.size(), f.targets, batch);
+	SweepEach(f, each);
+	size_t disagree = batch.size() != each.size();
+	for (size_t i = 0; !disagree && i < batch.size(); i++)
+		disagree += batch[i].segment != each[i].segment || batch[i].target != each[i].target || batch[i].toi != each[i].toi;
+	Report("batch disagreeing with one at a time", (double)disagree, "hits");
+
+	double pairs = (double)PROJECTILES * TARGETS;
+	Report("one box at a time", NsPerOp(50, [&](uint64_t) {
+		each.clear();
+		SweepEach(f, each);
+		Consume(each.size());
+	}) / pairs, "ns/pair");
+	Report("batch", NsPerOp(50, [&](uint64_t) {
+		batch.clear();
+		SweepBatch(f.from.data(), f.to.data(), f.from.size(), f.targets, batch);
+		Consume(batch.size());
+	}) / pairs, "ns/pair");
+}
@@ -0,0 +1,62 @@
+// Bench: microbenchmarks for the pieces of the client and server that run every frame.
+// Usage: Bench [--replay file.wdr] [--record] [name...]
+// Runs every benchmark when no name is given. Exits with 1 when a check fails.
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Bench.h"
+
+volatile uint64_t benchSink = 0;
+BenchOptions benchOptions = { nullptr, false };
+int benchFailures = 0;
+
+struct Benchmark {
+	const char* name;
+	void(*run)();
+};
+
+static const Benchmark benchmarks[] = {
+	{ "codec", BenchCodec },
+	{ "replay", BenchReplay },
+	{ "sim", BenchSim },
+	{ "sweep", BenchSweep },
+	{ "aabb", BenchAabb },
+	{ "broadphase", BenchBroadphase },
+	{ "bvh", BenchBvh },
+	{ "obb", BenchObb },
+};
+
+int main(int argc, char** argv)
+{
+	std::vector<const char*> names;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+			benchOptions.replay = argv[++i];
+		else if (!strcmp(argv[i], "--record"))
+			benchOptions.record = true;
+		else
+			names.push_back(argv[i]);
+	}
+
+	int ran = 0;
+	for (const Benchmark& b : benchmarks) {
+		bool wanted = names.empty();
+		for (const char* name : names)
+			wanted = wanted || !strcmp(name, b.name);
+		if (!wanted)
+			continue;
+		std::cout << b.name << std::endl;
+		b.run();
+		ran++;
+	}
+	if (ran == 0) {
+		std::cerr << "no such benchmark; available:";
+		for (const Benchmark& b : benchmarks)
+			std::cerr << " " << b.name;
+		std::cerr << std::endl;
+		return 1;
+	}
+	return benchFailures ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include "BotSession.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include <glm/gtc/quaternion.hpp>
+
+// milliseconds() takes it by reference
+const int BotSession::CALL_TIMEOUT;
+
+BotSession::BotSession(const std::string& host, uint16_t port, int id, Clock::duration period, Clock::time_point start)
+	: client(host, port), id(id), period(period), start(start) {
+	// spread the sessions over the period so they do not all send at once
+	nextSend = start + period * (id % 97) / 97;
+}
+
+void BotSession::poll(Clock::time_point now, bool record, BotStats& stats) {
+	if (call.valid()) {
+		if (call.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			// stamped here, not at the start of the sweep: later sessions in the
+			// sweep would otherwise all be rounded to it
+			auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sentAt).count();
+			try {
+				Packet packet = call.get().as<Packet>();
+				SyncReply reply;
+				if (!UnpackDeltaSyncReply(packet, reply, baselines)) {
+					baselines.clear();
+					ackTick = 0;
+					throw std::runtime_error("bad delta reply");
+				}
+				stats.received++;
+				stats.bytes += packet.size();
+				if (record)
+					stats.rtt.record((uint32_t)rtt);
+				lastTick = reply.tick;
+				ackTick = (uint32_t)reply.tick;
+			}
+			catch (const std::exception&) {
+				stats.failed++;
+			}
+		}
+		else if (now - sentAt > std::chrono::milliseconds(CALL_TIMEOUT)) {
+			// rpclib still completes the call later; we just stop waiting for it
+			call = std::future<RPCLIB_MSGPACK::object_handle>();
+			stats.timeouts++;
+		}
+		else {
+			if (now >= nextSend)
+				stats.late++;
+			return;
+		}
+	}
+	if (now < nextSend)
+		return;
+
+	double t = std::chrono::duration<double>(now - start).count();
+	Packet request = PackDeltaSyncRequest(pose(t), lastTick, ackTick, ++inputSeq);
+	sentAt = Clock::now();
+	call = client.async_call("sync_delta", request);
+	stats.sent++;
+	// keep the cadence, but do not try to catch up after a stall
+	nextSend = std::max(nextSend + period, now);
+}
+
+void BotSession::leave() {
+	try {
+		client.call("leave");
+	}
+	catch (const std::exception&) {
+	}
+}
+
+// A player shifting on their feet and waving the gun about, pulling the
+// trigger for half a second every few seconds. Every session moves a little
+// differently so the deltas look like real traffic.
+Player BotSession::pose(double t) const {
+	Player p = {};
+	double phase = id * 0.37;
+	p.headPos = glm::vec3(0.1f * (float)sin(t * 0.7 + phase), 1.7f + 0.02f * (float)sin(t * 2.1), 0.05f * (float)cos(t * 0.5 + phase));
+	p.handpos = p.headPos + glm::vec3(0.25f + 0.1f * (float)sin(t * 1.3 + phase), -0.4f, -0.3f);
+	p.headrotation = glm::angleAxis(0.3f * (float)sin(t * 0.9 + phase), glm::vec3(0.0f, 1.0f, 0.0f));
+	p.handrotation = glm::angleAxis(0.5f * (float)sin(t * 1.7 + phase), glm::vec3(1.0f, 0.0f, 0.0f));
+	p.rotation = p.headrotation;
+	p.viewDir = p.headrotation * glm::vec3(0.0f, 0.0f, -1.0f);
+	p.shootDir = p.handrotation * glm::vec3(0.0f, 0.0f, -1.0f);
+	p.pickedUp = true;
+	p.fire = fmod(t + phase, 3.0 + id % 5) < 0.5;
+	return p;
+}
@@ -0,0 +1,67 @@
+#ifndef BOTSESSION_H
+#define BOTSESSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+
+#include "rpc/client.h"
+// Shared struct
+#include "Player.h"
+#include "PlayerCodec.h"
+#include "Protocol.h"
+#include "SnapshotDelta.h"
+
+#include "LatencyRecorder.h"
+
+// Counters of one driver thread
+struct BotStats {
+	LatencyRecorder rtt;
+	uint64_t sent = 0;
+	uint64_t received = 0;
+	uint64_t failed = 0;   // rpc errors and undecodable replies
+	uint64_t timeouts = 0; // calls abandoned after CALL_TIMEOUT
+	uint64_t late = 0;     // sends held back by a reply that was not in yet
+	uint64_t bytes = 0;    // reply payload received
+	uint64_t sweeps = 0;   // passes over the driver's sessions...
+	int64_t sweepUs = 0;   // ...and the time they took, sleep included
+};
+
+// One fake player: its own rpc connection, so its own seat on the server (and
+// its own rpclib io thread), sending synthetic poses with "sync_delta" the way
+// the headset client does. A session keeps at most one call in flight and
+// never blocks; a driver thread polls many of them in turn.
+class BotSession {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static const int CALL_TIMEOUT = 1000; // ms before a call is abandoned
+
+	BotSession(const std::string& host, uint16_t port, int id, Clock::duration period, Clock::time_point start);
+
+	// picks up a finished reply and sends the next pose when it is due;
+	// round trips are only recorded when record is set (past the warmup). A
+	// reply is only seen when its session is polled, so a round trip can read
+	// up to one sweep of the driver thread long.
+	void poll(Clock::time_point now, bool record, BotStats& stats);
+	void leave();
+
+private:
+	Player pose(double t) const;
+
+	rpc::client client;
+	int id;
+	Clock::duration period;
+	Clock::time_point start;
+	Clock::time_point nextSend;
+	Clock::time_point sentAt;
+	std::future<RPCLIB_MSGPACK::object_handle> call;
+
+	uint64_t lastTick = 0;
+	uint32_t ackTick = 0;
+	uint32_t inputSeq = 0;
+	SnapshotRing baselines;
+};
+
+#endif
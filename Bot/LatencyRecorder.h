@@ -0,0 +1,38 @@
+#ifndef LATENCYRECORDER_H
+#define LATENCYRECORDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Round trip times in microseconds. Every sample is kept so the tail
+// percentiles are exact; a few million of them is only a few megabytes.
+// One recorder per driver thread, merged for the report.
+class LatencyRecorder {
+public:
+	void record(uint32_t us) { samples.push_back(us); }
+
+	void merge(const LatencyRecorder& other) {
+		samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+	}
+
+	size_t count() const { return samples.size(); }
+
+	// q in [0, 1]; reorders the samples
+	uint32_t percentile(double q) {
+		if (samples.empty())
+			return 0;
+		size_t k = std::min(samples.size() - 1, (size_t)(q * samples.size()));
+		std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+		return samples[k];
+	}
+
+	uint32_t max() const {
+		return samples.empty() ? 0 : *std::max_element(samples.begin(), samples.end());
+	}
+
+private:
+	std::vector<uint32_t> samples;
+};
+
+#endif
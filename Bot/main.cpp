@@ -0,0 +1,142 @@
+// Bot: headless load generator for the duel server.
+//
+// Opens one rpc session per fake player and streams synthetic poses over
+// "sync_delta" at a fixed rate, then reports round trip percentiles and
+// throughput. Needs rpclib and glm, nothing else: no headset, no GPU, no OVR
+// runtime.
+// Every session is an rpc::client, and rpclib gives each client its own io
+// thread, so a run costs one thread per session on top of the driver threads;
+// --sessions is capped at MAX_SESSIONS for that reason.
+// On Linux, with rpclib built from source:
+//   g++ -std=c++14 -O2 -IShared -IServer -IBot -I<rpclib>/include -I<glm> Bot/*.cpp -L<rpclib>/build -lrpc -pthread -o bot
+//
+//   bot [--server host] [--port 8050] [--sessions 256] [--rate 90]
+//       [--seconds 30] [--warmup 2] [--threads 4]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rpc/client.h"
+
+#include "BotSession.h"
+#include "LatencyRecorder.h"
+
+#define PORT 8050
+#define SWEEP_INTERVAL std::chrono::microseconds(200)
+#define MAX_SESSIONS 256 // one io thread each, see above
+
+typedef std::chrono::steady_clock Clock;
+
+// "shards" rpc: matches, ticks, dropped ticks and busy fraction per shard
+std::vector<double> ShardStats(const std::string& host, uint16_t port) {
+	try {
+		rpc::client c(host, port);
+		return c.call("shards").as<std::vector<double>>();
+	}
+	catch (const std::exception& e) {
+		std::cerr << "no shard stats: " << e.what() << std::endl;
+		return std::vector<double>();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string host = "127.0.0.1";
+	uint16_t port = PORT;
+	int sessions = MAX_SESSIONS;
+	int rate = 90;
+	double seconds = 30.0;
+	double warmup = 2.0;
+	int threads = 4;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--server") && i + 1 < argc)
+			host = argv[++i];
+		else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+			port = (uint16_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--sessions") && i + 1 < argc)
+			sessions = std::min(MAX_SESSIONS, std::max(1, atoi(argv[++i])));
+		else if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+			rate = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+			seconds = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+			warmup = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+	}
+	threads = std::min(threads, sessions);
+
+	std::cout << "Connecting " << sessions << " sessions to " << host << ":" << port << ", " << rate
+		<< " Hz each, for " << seconds << " s after " << warmup << " s of warmup" << std::endl;
+	std::vector<double> shardsBefore = ShardStats(host, port);
+
+	auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+	auto start = Clock::now();
+	std::vector<std::unique_ptr<BotSession>> bots;
+	for (int i = 0; i < sessions; i++)
+		bots.emplace_back(new BotSession(host, port, i, period, start));
+
+	// each driver thread polls its own slice of the sessions
+	auto measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(warmup));
+	auto end = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+	std::vector<BotStats> stats(threads);
+	std::vector<std::thread> drivers;
+	for (int t = 0; t < threads; t++) {
+		drivers.emplace_back([&, t] {
+			for (auto now = Clock::now(); now < end;) {
+				bool record = now >= measureFrom;
+				for (size_t i = t; i < bots.size(); i += threads)
+					bots[i]->poll(now, record, stats[t]);
+				std::this_thread::sleep_for(SWEEP_INTERVAL);
+				auto swept = Clock::now();
+				if (record) {
+					stats[t].sweeps++;
+					stats[t].sweepUs += std::chrono::duration_cast<std::chrono::microseconds>(swept - now).count();
+				}
+				now = swept;
+			}
+		});
+	}
+	for (std::thread& d : drivers)
+		d.join();
+	std::vector<double> shardsAfter = ShardStats(host, port);
+	for (auto& bot : bots)
+		bot->leave();
+
+	BotStats total;
+	for (const BotStats& s : stats) {
+		total.rtt.merge(s.rtt);
+		total.sent += s.sent;
+		total.received += s.received;
+		total.failed += s.failed;
+		total.timeouts += s.timeouts;
+		total.late += s.late;
+		total.bytes += s.bytes;
+		total.sweeps += s.sweeps;
+		total.sweepUs += s.sweepUs;
+	}
+	double elapsed = std::chrono::duration<double>(end - start).count();
+	double measured = (double)total.rtt.count();
+	std::cout << total.received << "/" << total.sent << " replies, " << total.failed << " failed, " << total.timeouts
+		<< " timed out, " << total.late << " sweeps held back by a late reply" << std::endl;
+	std::cout << "throughput: " << measured / seconds << " replies/s measured (" << total.received / elapsed
+		<< " overall, " << (double)sessions * rate << " offered), " << total.bytes / elapsed / 1024.0 << " KiB/s received" << std::endl;
+	std::cout << "rtt ms: p50 " << total.rtt.percentile(0.5) / 1000.0 << ", p99 " << total.rtt.percentile(0.99) / 1000.0
+		<< ", p999 " << total.rtt.percentile(0.999) / 1000.0 << ", max " << total.rtt.max() / 1000.0
+		<< " (replies are seen within one sweep, " << (total.sweeps ? total.sweepUs / (double)total.sweeps : 0.0) << " us a sweep on average)" << std::endl;
+
+	// server side: ticks and dropped ticks per shard over the run
+	for (size_t i = 0; i + 3 < shardsAfter.size() && shardsBefore.size() == shardsAfter.size(); i += 4) {
+		std::cout << "shard " << i / 4 << ": " << shardsAfter[i] << " matches, "
+			<< (shardsAfter[i + 1] - shardsBefore[i + 1]) / elapsed << " ticks/s, "
+			<< shardsAfter[i + 2] - shardsBefore[i + 2] << " dropped, " << (int)(shardsAfter[i + 3] * 100.0) << "% busy" << std::endl;
+	}
+	return 0;
+}
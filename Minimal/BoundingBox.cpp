@@ -1,7 +1,5 @@
 #include "BoundingBox.h"
 
-
-#define INFINITY 999999.9f
 BoundingBox::BoundingBox(std::vector<GLfloat> edges, std::vector<glm::vec3> vertices) {
 	this->toWorld = glm::mat4(1.0f);
 
@@ -12,6 +10,7 @@ BoundingBox::BoundingBox(std::vector<GLfloat> edges, std::vector<glm::vec3> vert
 
 	edgesBoundingBox = edges;
 	verticesBoundingBox = vertices;
+	local = BoundsOf(vertices);
 
 	// Bind the Vertex Array Object first, then bind and set vertex buffer(s) and attribute pointer(s).
 	glBindVertexArray(VAO);
@@ -79,52 +78,3 @@ void BoundingBox::draw(GLuint shaderProgram, const glm::mat4& projection, const
 
 	glBindVertexArray(0);
 }
-
-std::vector<float> BoundingBox::getBoundary() {
-	std::vector<glm::vec3> new_pos;
-	std::vector<float> boundary;
-	float minX = INFINITY, minY = INFINITY, minZ = INFINITY;   // min vertex
-	float maxX = -INFINITY, maxY = -INFINITY, maxZ = -INFINITY;   // max vertex
-
-	/*
-	std::cout << toWorld[0][0] << " " << toWorld[1][0] << " " << toWorld[2][0] << " " << toWorld[3][0] << std::endl;
-	std::cout << toWorld[0][1] << " " << toWorld[1][1] << " " << toWorld[2][1] << " " << toWorld[3][1] << std::endl;
-	std::cout << toWorld[0][2] << " " << toWorld[1][2] << " " << toWorld[2][2] << " " << toWorld[3][2] << std::endl;
-	std::cout << toWorld[0][3] << " " << toWorld[1][3] << " " << toWorld[2][3] << " " << toWorld[3][3] << std::endl;
-	 */
-
-	for (int i = 0; i < verticesBoundingBox.size(); i++) {
-		glm::vec3 newpos = glm::mat3(toWorld) * verticesBoundingBox[i];
-		newpos = newpos + glm::vec3(toWorld[3][0], toWorld[3][1], toWorld[3][2]);
-		new_pos.push_back(newpos);
-
-		// check for min and max
-		if (newpos.x < minX) {
-			minX = newpos.x;
-		}
-		if (newpos.y < minY) {
-			minY = newpos.y;
-		}
-		if (newpos.z < minZ) {
-			minZ = newpos.z;
-		}
-		if (newpos.x > maxX) {
-			maxX = newpos.x;
-		}
-		if (newpos.y > maxY) {
-			maxY = newpos.y;
-		}
-		if (newpos.z > maxZ) {
-			maxZ = newpos.z;
-		}
-	}
-
-	boundary.push_back(maxX);
-	boundary.push_back(minX);
-	boundary.push_back(maxY);
-	boundary.push_back(minY);
-	boundary.push_back(maxZ);
-	boundary.push_back(minZ);
-
-	return boundary;
-}
\ No newline at end of file
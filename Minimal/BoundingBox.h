@@ -8,14 +8,24 @@
 
 #include <vector>
 
+#include "Aabb.h"
+#include "Obb.h"
+
 class BoundingBox {
 public:
 	// constructor destructor
 	BoundingBox(std::vector<GLfloat>, std::vector<glm::vec3>);
 	~BoundingBox();
 	bool collisionflag = false;
+	// set for boxes that can cross others within one step, like bullets:
+	// CollisionWorld pairs them with everything between last and bounds()
+	bool swept = false;
+	Aabb last;
 	void draw(GLuint shaderProgram,  const glm::mat4& projection, const glm::mat4& view);
-	std::vector<float> getBoundary();
+	// the world box around the model, from toWorld
+	Aabb bounds() const { return TransformAabb(toWorld, local); }
+	// the same box turned with the model, for a tighter test once bounds() touch
+	Obb orientedBounds() const { return OrientedBox(toWorld, local); }
 
 	glm::mat4 toWorld;
 	glm::vec3 min;
@@ -23,6 +33,7 @@ public:
 
 	GLuint VBO, VAO, EBO;
 	std::vector<glm::vec3> verticesBoundingBox;
+	Aabb local;
 	std::vector<GLfloat> edgesBoundingBox;
 	std::vector<GLfloat> indicesBoundingBox = {
 		// Front face
@@ -0,0 +1,49 @@
+#include "CollisionWorld.h"
+
+CollisionWorld::~CollisionWorld() {
+	for (BoundingBox* box : boxes)
+		delete box;
+}
+
+BoundingBox* CollisionWorld::add(const std::vector<GLfloat>& edges, const std::vector<glm::vec3>& vertices) {
+	BoundingBox* box = new BoundingBox(edges, vertices);
+	box->last = box->bounds();
+	proxies.push_back(tree.insert(box->last, (uint32_t)boxes.size()));
+	boxes.push_back(box);
+	return box;
+}
+
+void CollisionWorld::remove(BoundingBox* box) {
+	for (size_t i = 0; i < boxes.size(); i++) {
+		if (boxes[i] != box)
+			continue;
+		tree.remove(proxies[i]);
+		// the last box takes the free slot and goes back in the tree under it
+		boxes[i] = boxes.back();
+		proxies[i] = proxies.back();
+		boxes.pop_back();
+		proxies.pop_back();
+		if (i < boxes.size()) {
+			tree.remove(proxies[i]);
+			proxies[i] = tree.insert(boxes[i]->bounds(), (uint32_t)i);
+		}
+		delete box;
+		return;
+	}
+}
+
+void CollisionWorld::step(const PairHandler& handler) {
+	for (size_t i = 0; i < boxes.size(); i++) {
+		BoundingBox* box = boxes[i];
+		Aabb now = box->bounds();
+		tree.move(proxies[i], box->swept ? Union(box->last, now) : now);
+		box->last = now;
+		box->collisionflag = false;
+	}
+	tree.pairs([&](uint32_t a, uint32_t b) {
+		if (handler && !handler(boxes[a], boxes[b]))
+			return;
+		boxes[a]->collisionflag = true;
+		boxes[b]->collisionflag = true;
+	});
+}
@@ -0,0 +1,39 @@
+#ifndef COLLISIONWORLD_H
+#define COLLISIONWORLD_H
+
+#include <functional>
+#include <vector>
+
+#include "BoundingBox.h"
+// Shared broad phase
+#include "AabbTree.h"
+
+// Owns every BoundingBox in the scene and keeps their world boxes in an
+// AabbTree, so a tick finds the overlapping pairs without anyone writing a
+// check per pair of boxes. Bullets, props and players only need to be added.
+class CollisionWorld {
+public:
+	// the narrow phase: whether two boxes that overlap really touch
+	typedef std::function<bool(BoundingBox*, BoundingBox*)> PairHandler;
+
+	~CollisionWorld();
+
+	// a new box around a model's vertices (Model::boundingbox, Model::boxVertices)
+	BoundingBox* add(const std::vector<GLfloat>& edges, const std::vector<glm::vec3>& vertices);
+	void remove(BoundingBox* box);
+
+	// Refits every box to its toWorld, a swept one to the union of where it
+	// was at the last step and where it is now, hands each overlapping pair
+	// to handler and flags the boxes (collisionflag) of the pairs it
+	// confirms, or of every pair without one
+	void step(const PairHandler& handler = PairHandler());
+
+	size_t size() const { return boxes.size(); }
+
+private:
+	AabbTree tree;
+	std::vector<BoundingBox*> boxes;
+	std::vector<int> proxies; // boxes[i] is proxies[i] in the tree
+};
+
+#endif
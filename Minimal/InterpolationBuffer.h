@@ -0,0 +1,167 @@
+#ifndef INTERPOLATIONBUFFER_H
+#define INTERPOLATIONBUFFER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <boost/circular_buffer.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Shared struct
+#include "Player.h"
+
+struct InterpolationStats {
+	size_t depth;          // snapshots buffered ahead of the render time
+	double delayMs;        // current interpolation delay
+	double jitterMs;       // smoothed arrival jitter the delay is sized for
+	uint64_t underruns;    // frames that had to extrapolate past the newest snapshot
+	uint64_t frozen;       // frames that hit the extrapolation limit and held the pose
+	uint64_t late;         // snapshots that arrived behind the render time
+};
+
+// Blend between two snapshots of a player at t in [0, 1]; t > 1 extrapolates.
+// Flags are not blended: they come from the snapshot the render time has reached.
+inline Player InterpolatePlayer(const Player& a, const Player& b, float t) {
+	Player p = t < 1.0f ? a : b;
+	p.rotation = glm::slerp(a.rotation, b.rotation, t);
+	p.handrotation = glm::slerp(a.handrotation, b.handrotation, t);
+	p.headrotation = glm::slerp(a.headrotation, b.headrotation, t);
+	p.handpos = glm::mix(a.handpos, b.handpos, t);
+	p.headPos = glm::mix(a.headPos, b.headPos, t);
+	p.viewDir = glm::mix(a.viewDir, b.viewDir, t);
+	p.shootDir = glm::mix(a.shootDir, b.shootDir, t);
+	return p;
+}
+
+// Renders the opponent a little in the past so there is (almost) always a
+// snapshot on either side of the render time. Snapshots are placed on the
+// server's match clock; the local clock is mapped onto it through the smallest
+// transit delay seen, and the delay behind it grows with the measured arrival
+// jitter. When the buffer runs dry the last motion is extrapolated for a short while.
+class InterpolationBuffer {
+public:
+	static const int CAPACITY = 64;
+	static constexpr double MIN_DELAY = 0.010;          // seconds
+	static constexpr double MAX_DELAY = 0.250;
+	static constexpr double MAX_EXTRAPOLATION = 0.100;  // seconds past the newest snapshot
+	static constexpr double JITTER_MARGIN = 3.0;        // delay = interval + margin * jitter
+	static constexpr double SMOOTHING = 0.05;           // weight of a new sample in the averages
+	static constexpr double DELAY_SLEW = 0.05;          // max change of the delay per second of play
+	static constexpr double RESTART_GAP = 1.0;          // a clock this far behind means a new match
+
+	InterpolationBuffer() : snapshots(CAPACITY) {}
+
+	// serverTime: match time of the snapshot; now: local seconds
+	void push(double serverTime, double now, const Player& player) {
+		if (!snapshots.empty() && serverTime + RESTART_GAP < snapshots.back().time)
+			reset(); // the match restarted and its clock with it
+		if (!snapshots.empty() && serverTime <= snapshots.back().time)
+			return; // duplicate or reordered
+		// still worth keeping: it is the newest state there is to extrapolate from
+		if (started && serverTime < renderTime)
+			late++;
+
+		double offset = serverTime - now;
+		if (!snapshots.empty()) {
+			double interval = serverTime - snapshots.back().time;
+			double arrival = now - lastArrival;
+			intervalAvg += (interval - intervalAvg) * SMOOTHING;
+			jitter += (std::fabs(arrival - interval) - jitter) * SMOOTHING;
+			// the largest offset belongs to the fastest packet; drift back slowly for clock skew
+			clockOffset = offset > clockOffset ? offset : clockOffset + (offset - clockOffset) * SMOOTHING * 0.1;
+		}
+		else if (!started) {
+			clockOffset = offset;
+			intervalAvg = 1.0 / 90.0;
+		}
+		lastArrival = now;
+		snapshots.push_back({ serverTime, player });
+	}
+
+	void reset() {
+		snapshots.clear();
+		started = false;
+		renderTime = 0.0;
+		jitter = 0.0;
+	}
+
+	bool ready() const { return !snapshots.empty(); }
+
+	// the player as it should be drawn at local time now
+	Player sample(double now) {
+		// std::min/max bind references, and the members have no definition
+		const double lo = MIN_DELAY, hi = MAX_DELAY;
+		double target = std::min(hi, std::max(lo, intervalAvg + JITTER_MARGIN * jitter));
+		if (started) {
+			double step = DELAY_SLEW * std::max(0.0, now - lastSample);
+			delay += std::max(-step, std::min(step, target - delay));
+		}
+		else {
+			delay = target;
+			started = true;
+		}
+		lastSample = now;
+		renderTime = std::max(renderTime, now + clockOffset - delay);
+
+		// drop snapshots that are fully behind, keeping one at or before the render time
+		while (snapshots.size() > 2 && snapshots[1].time <= renderTime)
+			snapshots.pop_front();
+
+		if (snapshots.size() == 1)
+			return snapshots.front().player;
+		const Snapshot& a = snapshots[0];
+		const Snapshot& b = snapshots[1];
+		if (renderTime <= a.time)
+			return a.player;
+		if (renderTime <= b.time)
+			return InterpolatePlayer(a.player, b.player, (float)((renderTime - a.time) / (b.time - a.time)));
+
+		// past the newest snapshot: carry on along the last motion, then hold
+		underruns++;
+		double ahead = renderTime - b.time;
+		if (ahead > MAX_EXTRAPOLATION) {
+			frozen++;
+			ahead = MAX_EXTRAPOLATION;
+		}
+		return InterpolatePlayer(a.player, b.player, (float)(1.0 + ahead / (b.time - a.time)));
+	}
+
+	// match time of the pose the last sample() returned
+	double time() const { return renderTime; }
+
+	InterpolationStats stats() const {
+		InterpolationStats s;
+		s.depth = 0;
+		for (const Snapshot& snap : snapshots)
+			s.depth += snap.time > renderTime ? 1 : 0;
+		s.delayMs = delay * 1000.0;
+		s.jitterMs = jitter * 1000.0;
+		s.underruns = underruns;
+		s.frozen = frozen;
+		s.late = late;
+		return s;
+	}
+
+private:
+	struct Snapshot {
+		double time;
+		Player player;
+	};
+
+	boost::circular_buffer<Snapshot> snapshots;
+	bool started = false;
+	double clockOffset = 0.0; // server time - local time, for the fastest packet
+	double intervalAvg = 0.0;
+	double jitter = 0.0;
+	double lastArrival = 0.0;
+	double delay = 0.0;
+	double renderTime = 0.0;  // on the server clock
+	double lastSample = 0.0;
+	uint64_t underruns = 0;
+	uint64_t frozen = 0;
+	uint64_t late = 0;
+};
+
+#endif
@@ -96,6 +96,15 @@ public:
 		glActiveTexture(GL_TEXTURE0);
 	}
 
+	// frees the buffers on the GPU; copies of a mesh share them, so only
+	// their owner calls this, once
+	void release()
+	{
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+	}
+
 private:
 	/*  Render data  */
 	unsigned int VBO, EBO;
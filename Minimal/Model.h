@@ -11,6 +11,7 @@
 
 
 
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -19,11 +20,14 @@
 #include <vector>
 #include "stb_image.h"
 #include "Mesh.h"
+// Shared hit tests
+#include "MeshBvh.h"
 
 
 using namespace std;
 
-
+// what a model asks Assimp for unless told otherwise
+static const unsigned int MODEL_IMPORT = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
 
 class Model
 {
@@ -49,14 +53,26 @@ public:
 	glm::vec3 viewdir;
 	vector<Vertex> vertices;
 	vector<unsigned int> indices;
+	// the triangles above, for hit tests against the mesh; same space as boxVertices
+	MeshBvh bvh;
 	/*  Functions   */
 	// constructor, expects a filepath to a 3D model.
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+	Model(string const &path, bool gamma = false, unsigned int flags = MODEL_IMPORT) : gammaCorrection(gamma)
 	{
 		toWorld = glm::mat4(1.0f);
-		loadModel(path);
+		loadModel(path, flags);
 		scaleProcess();
 	}
+	// the meshes' copies share the GPU buffers and textures freed here
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+	~Model()
+	{
+		for (Mesh& mesh : meshes)
+			mesh.release();
+		for (Texture& texture : tex)
+			glDeleteTextures(1, &texture.id);
+	}
 
 	// draws the model, and thus all its meshes
 	void Draw(GLuint shader)
@@ -251,6 +267,11 @@ public:
 		boundingbox.push_back(maxY);
 		boundingbox.push_back(minZ);
 
+		std::vector<glm::vec3> positions;
+		positions.reserve(vertices.size());
+		for (const Vertex& v : vertices)
+			positions.push_back(v.Position);
+		bvh.build(positions, indices);
 	}
 	void fire() {
 		glm::mat4 translateMat = glm::translate(glm::mat4(1.0f), viewdir); //
@@ -271,11 +292,11 @@ private:
 	/*  Functions   */
 	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
 	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-	void loadModel(string const &path)
+	void loadModel(string const &path, unsigned int flags)
 	{
 		// read file via ASSIMP
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		const aiScene* scene = importer.ReadFile(path, flags);
 		// check for errors
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
@@ -320,6 +341,8 @@ private:
 		// data to fill
 		
 		vector<Texture> textures;
+		// this mesh's vertices go after the ones of the meshes before it
+		unsigned int base = vertices.size();
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
 			Vertex vertex;
@@ -412,7 +435,7 @@ private:
 			aiFace face = mesh->mFaces[i];
 			// retrieve all indices of the face and store them in the indices vector
 			for (unsigned int j = 0; j < face.mNumIndices; j++)
-				indices.push_back(face.mIndices[j]);
+				indices.push_back(base + face.mIndices[j]);
 		}
 		// process materials
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
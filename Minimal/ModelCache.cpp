@@ -0,0 +1,18 @@
+#include "ModelCache.h"
+
+std::shared_ptr<Model> ModelCache::get(const std::string& path, unsigned int flags) {
+	std::weak_ptr<Model>& entry = models[std::make_pair(path, flags)];
+	std::shared_ptr<Model> model = entry.lock();
+	if (!model) {
+		model = std::make_shared<Model>(path, false, flags);
+		entry = model;
+	}
+	return model;
+}
+
+size_t ModelCache::size() const {
+	size_t held = 0;
+	for (const auto& entry : models)
+		held += !entry.second.expired();
+	return held;
+}
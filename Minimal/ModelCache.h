@@ -0,0 +1,27 @@
+#ifndef MODELCACHE_H
+#define MODELCACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "Model.h"
+
+// Hands out one Model per file and set of import flags, so a scene asking for
+// sphere.obj five times imports, scales, uploads and builds its tree once. The
+// cache only keeps weak references: a model is freed, GPU buffers and textures
+// with it, when the last holder lets go. Each holder draws the shared model
+// with its own transform, as the scene does through its BoundingBoxes.
+class ModelCache {
+public:
+	std::shared_ptr<Model> get(const std::string& path, unsigned int flags = MODEL_IMPORT);
+
+	// models still held by someone
+	size_t size() const;
+
+private:
+	std::map<std::pair<std::string, unsigned int>, std::weak_ptr<Model>> models;
+};
+
+#endif
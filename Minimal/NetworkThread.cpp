@@ -0,0 +1,363 @@
+#include "NetworkThread.h"
+
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+
+typedef std::chrono::steady_clock Clock;
+
+// milliseconds() takes these by reference
+const int NetworkThread::CALL_TIMEOUT;
+const int NetworkThread::CLOCK_BURST_PERIOD;
+const int NetworkThread::CLOCK_PERIOD;
+
+NetworkThread::NetworkThread(rpc::client& client, const NetworkOptions& options) : client(client), options(options) {
+}
+
+NetworkThread::~NetworkThread() {
+	stop();
+}
+
+void NetworkThread::start() {
+	if (running.exchange(true))
+		return;
+	worker = std::thread(&NetworkThread::run, this);
+	clockWorker = std::thread(&NetworkThread::runClock, this);
+}
+
+void NetworkThread::stop() {
+	running = false;
+	if (worker.joinable())
+		worker.join();
+	if (clockWorker.joinable())
+		clockWorker.join();
+}
+
+void NetworkThread::submit(const Player& local, uint32_t inputSeq) {
+	auto begin = Clock::now();
+	Frame& frame = outgoing.writeSlot();
+	frame.seq = inputSeq;
+	frame.player = local;
+	outgoing.publish();
+	renderWaitNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count(), std::memory_order_relaxed);
+	frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool NetworkThread::latest(SyncReply& reply, Clock::time_point* receivedAt) {
+	auto begin = Clock::now();
+	if (incoming.update())
+		haveReply = true;
+	if (haveReply) {
+		const Published& p = incoming.read();
+		reply = p.reply;
+		if (receivedAt)
+			*receivedAt = p.received;
+		consumed.store(p.seq, std::memory_order_relaxed);
+	}
+	renderWaitNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count(), std::memory_order_relaxed);
+	return haveReply;
+}
+
+void NetworkThread::shoot(const Shot& shot) {
+	std::lock_guard<std::mutex> lock(shotLock);
+	shots.push_back(shot);
+}
+
+bool NetworkThread::matchTime(double local, double& time) const {
+	if (!clockSynced.load(std::memory_order_acquire))
+		return false;
+	time = local + clockOffset.load(std::memory_order_relaxed);
+	return true;
+}
+
+NetworkStats NetworkThread::stats() const {
+	NetworkStats s;
+	s.frames = frames.load();
+	s.renderWaitMs = renderWaitNs.load() * 1e-6;
+	s.sent = sent.load();
+	s.received = received.load();
+	s.failed = failed.load();
+	s.lastRttMs = lastRttNs.load() * 1e-6;
+	s.bytesReceived = bytesReceived.load();
+	s.udp = udp.load();
+	s.stale = stale.load();
+	s.clockSynced = clockSynced.load();
+	s.clockOffsetMs = clockOffset.load() * 1000.0;
+	s.clockRttMs = clockRtt.load() * 1000.0;
+	return s;
+}
+
+void NetworkThread::run() {
+	if (!waitForFirstFrame())
+		return;
+	if (options.udp && openPoseChannel())
+		runUdp();
+	else
+		runTcp();
+}
+
+// Clock samples on their own thread: a sample is only as good as its
+// timestamps, so this one waits on nothing but the "clock" reply.
+void NetworkThread::runClock() {
+	auto seconds = [] { return std::chrono::duration<double>(Clock::now().time_since_epoch()).count(); };
+	while (running) {
+		double sent = seconds();
+		auto call = client.async_call("clock");
+		bool ok = call.wait_for(std::chrono::milliseconds(CALL_TIMEOUT)) == std::future_status::ready;
+		double received = seconds();
+		try {
+			if (ok) {
+				ClockReply reply = call.get().as<ClockReply>();
+				clock.addSample(sent, reply.time, received);
+				startTime.store(reply.startAt, std::memory_order_relaxed);
+			}
+		}
+		catch (const std::exception& e) {
+			std::cerr << "clock failed: " << e.what() << std::endl;
+		}
+		if (clock.ready()) {
+			clockOffset.store(clock.offset(), std::memory_order_relaxed);
+			clockRtt.store(clock.rtt(), std::memory_order_relaxed);
+			clockSynced.store(true, std::memory_order_release);
+		}
+
+		// a quick burst to sync, then resample to follow drift and route changes
+		auto wait = std::chrono::milliseconds(clock.ready() ? CLOCK_PERIOD : CLOCK_BURST_PERIOD);
+		for (auto until = Clock::now() + wait; running && Clock::now() < until;)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+// nothing to send until the render thread produced its first frame
+bool NetworkThread::waitForFirstFrame() {
+	while (running && frames.load(std::memory_order_relaxed) == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return running;
+}
+
+bool NetworkThread::openPoseChannel() {
+	PoseTicket ticket;
+	try {
+		ticket = client.call("udp_token").as<PoseTicket>();
+	}
+	catch (const std::exception& e) {
+		std::cerr << "no pose channel: " << e.what() << std::endl;
+		return false;
+	}
+	// a proxy in between (NetProxy) listens on a port of its own
+	uint16_t port = options.udpPort ? options.udpPort : ticket.port;
+	if (ticket.token == 0 || !socket.open() || !UdpSocket::resolve(options.host.c_str(), port, server))
+		return false;
+	socket.setLoss(options.udpLoss);
+	token = ticket.token;
+	udp = true;
+	return true;
+}
+
+// the session's token, which the server forgets when it reaps the session
+void NetworkThread::renewToken() {
+	try {
+		PoseTicket ticket = client.call("udp_token").as<PoseTicket>();
+		if (ticket.token != 0)
+			token = ticket.token;
+	}
+	catch (const std::exception& e) {
+		std::cerr << "udp_token failed: " << e.what() << std::endl;
+	}
+}
+
+void NetworkThread::addEvents(const std::vector<Event>& events) {
+	for (const Event& e : events)
+		unread.push_back({ 0, e });
+}
+
+void NetworkThread::publish(SyncReply reply, Clock::time_point received) {
+	// keep the events the render thread has not picked up yet
+	uint64_t seen = consumed.load(std::memory_order_relaxed);
+	unread.erase(std::remove_if(unread.begin(), unread.end(), [seen](const PendingEvent& e) {
+		return e.publishedIn != 0 && e.publishedIn <= seen;
+	}), unread.end());
+
+	Published& p = incoming.writeSlot();
+	p.seq = ++publishes;
+	p.received = received;
+	reply.events.clear();
+	for (PendingEvent& e : unread) {
+		if (e.publishedIn == 0)
+			e.publishedIn = p.seq;
+		reply.events.push_back(e.event);
+	}
+	p.reply = reply;
+	incoming.publish();
+}
+
+// fire and forget: the outcome comes back as an event
+void NetworkThread::sendShots() {
+	std::vector<Shot> pending;
+	{
+		std::lock_guard<std::mutex> lock(shotLock);
+		pending.swap(shots);
+	}
+	for (const Shot& shot : pending)
+		client.async_call("shoot", shot);
+}
+
+// one sync_delta round trip per send period
+void NetworkThread::runTcp() {
+	const auto period = std::chrono::microseconds(1000000 / SEND_RATE);
+	auto next = Clock::now();
+
+	while (running) {
+		sendShots();
+		outgoing.update();
+		auto begin = Clock::now();
+		const Frame& frame = outgoing.read();
+		auto call = client.async_call("sync_delta", PackDeltaSyncRequest(frame.player, lastTick, ackTick, frame.seq));
+		sent++;
+		if (call.wait_for(std::chrono::milliseconds(CALL_TIMEOUT)) != std::future_status::ready) {
+			// rpclib still completes the call later; we just stop waiting for it
+			failed++;
+			continue;
+		}
+
+		SyncReply reply;
+		bool ok = true;
+		try {
+			Packet packet = call.get().as<Packet>();
+			bytesReceived.fetch_add(packet.size(), std::memory_order_relaxed);
+			if (!UnpackDeltaSyncReply(packet, reply, baselines)) {
+				// start over from a full snapshot
+				baselines.clear();
+				ackTick = 0;
+				throw std::runtime_error("bad delta reply");
+			}
+		}
+		catch (const std::exception& e) {
+			std::cerr << "sync failed: " << e.what() << std::endl;
+			failed++;
+			ok = false;
+		}
+		if (ok) {
+			lastRttNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+			received++;
+			addEvents(reply.events);
+			lastTick = reply.tick;
+			ackTick = (uint32_t)reply.tick;
+			publish(reply, Clock::now());
+		}
+
+		next = std::max(next + period, Clock::now() - period);
+		std::this_thread::sleep_until(next);
+	}
+}
+
+// poses and snapshots over the pose channel, events over rpc
+void NetworkThread::runUdp() {
+	const auto period = std::chrono::microseconds(1000000 / SEND_RATE);
+	const uint32_t SEND_HISTORY = 64; // send times kept for the rtt estimate
+	Clock::time_point sentAt[SEND_HISTORY];
+	uint32_t sentSeq[SEND_HISTORY] = {};
+	uint32_t seq = 0;
+	uint32_t newestTick = 0;
+	unsigned char buf[MAX_DATAGRAM_SIZE];
+
+	std::future<RPCLIB_MSGPACK::object_handle> eventCall;
+	uint64_t eventTick = 0;
+	uint32_t seating = 0;   // as of the last events reply, 0 before the first
+	uint32_t seatedAt = 0;  // snapshots answering poses up to here are from the old seat
+	SyncReply current = {};
+	Clock::time_point currentReceived;
+	bool haveCurrent = false;
+	auto next = Clock::now();
+
+	while (running) {
+		sendShots();
+		outgoing.update();
+		const Frame& frame = outgoing.read();
+		PoseDatagram pose = { token, ++seq, ackTick, frame.seq, frame.player };
+		size_t size = PackPoseDatagram(pose, buf);
+		sentAt[seq % SEND_HISTORY] = Clock::now();
+		sentSeq[seq % SEND_HISTORY] = seq;
+		socket.sendTo(server, buf, size);
+		sent++;
+
+		// events stay reliable; at most one call in flight
+		if (!eventCall.valid()) {
+			eventCall = client.async_call("events", eventTick);
+		}
+		else if (eventCall.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			try {
+				EventReply events = eventCall.get().as<EventReply>();
+				if (seating != 0 && events.seating != seating) {
+					// Seated again: maybe in a match already running, whose ticks
+					// need not be above ours, and with a new token if we were reaped.
+					// Start over from a full snapshot and the new match's events.
+					renewToken();
+					seatedAt = seq;
+					newestTick = 0;
+					haveCurrent = false;
+					eventTick = 0;
+					ackTick = 0;
+					baselines.clear();
+				}
+				else {
+					eventTick = events.tick;
+					addEvents(events.events);
+					if (haveCurrent && !events.events.empty())
+						publish(current, currentReceived);
+				}
+				seating = events.seating;
+			}
+			catch (const std::exception& e) {
+				std::cerr << "events failed: " << e.what() << std::endl;
+				failed++;
+			}
+		}
+
+		// take snapshots until the next pose is due
+		next = std::max(next + period, Clock::now() - period);
+		for (auto now = Clock::now(); now < next && running; now = Clock::now()) {
+			int timeout = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() + 1;
+			UdpAddress from;
+			int got = socket.receiveFrom(from, buf, sizeof(buf), timeout);
+			if (got < 0)
+				break;
+			uint32_t answered;
+			Packet packet;
+			if (got == 0 || !(from == server) || !UnpackSnapshotDatagram(buf, got, answered, packet) || packet.size() < 4)
+				continue;
+			if (answered <= seatedAt)
+				continue; // sent for the seat we had before
+
+			// drop stale: a snapshot that lost the race to a newer one is useless
+			const unsigned char* in = &packet[0];
+			uint32_t tick = codec::get32(in);
+			bool restarted = haveCurrent && tick + RESTART_TICKS < newestTick;
+			if (haveCurrent && tick <= newestTick && !restarted) {
+				stale++;
+				continue;
+			}
+			SyncReply reply;
+			if (!UnpackDeltaSyncReply(packet, reply, baselines)) {
+				// start over from a full snapshot
+				baselines.clear();
+				ackTick = 0;
+				failed++;
+				continue;
+			}
+			bytesReceived.fetch_add(got, std::memory_order_relaxed);
+			received++;
+			if (sentSeq[answered % SEND_HISTORY] == answered)
+				lastRttNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sentAt[answered % SEND_HISTORY]).count();
+			if (restarted)
+				eventTick = 0; // the new match's ticks start over, and its events with them
+			newestTick = tick;
+			ackTick = tick;
+			current = reply;
+			currentReceived = Clock::now();
+			haveCurrent = true;
+			publish(current, currentReceived);
+		}
+	}
+}
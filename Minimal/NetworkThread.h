@@ -0,0 +1,155 @@
+#ifndef NETWORKTHREAD_H
+#define NETWORKTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rpc/client.h"
+// Shared struct
+#include "Player.h"
+#include "ClockSync.h"
+#include "PlayerCodec.h"
+#include "PoseChannel.h"
+#include "SnapshotDelta.h"
+#include "Protocol.h"
+#include "TripleBuffer.h"
+#include "UdpSocket.h"
+
+struct NetworkOptions {
+	std::string host;     // same server as the rpc client
+	uint16_t port = 8050; // rpc port
+	bool udp = true;      // stream poses over the pose channel when the server offers one
+	uint16_t udpPort = 0; // pose channel port, 0 for the one the server advertises
+	double udpLoss = 0.0; // fraction of pose datagrams to drop, for testing
+};
+
+// Numbers for the network overlay. renderWait is time the render thread spent
+// inside submit()/latest(); it should stay at (almost) zero since neither blocks.
+struct NetworkStats {
+	uint64_t frames;
+	double renderWaitMs;
+	uint64_t sent;
+	uint64_t received;
+	uint64_t failed;
+	double lastRttMs;
+	uint64_t bytesReceived;
+	bool udp;       // poses go over the pose channel
+	uint64_t stale; // snapshots dropped for arriving after a newer one
+	bool clockSynced;
+	double clockOffsetMs; // match clock - local steady clock
+	double clockRttMs;    // fastest clock round trip in the window
+};
+
+// Talks to the server on its own thread so a slow or lost packet never stalls
+// rendering. The render thread hands over the local player and picks up the
+// newest server reply through triple buffers.
+class NetworkThread {
+public:
+	static const int SEND_RATE = 120; // Hz, upper bound on sync calls
+	static const int CALL_TIMEOUT = 1000; // ms before a sync call is abandoned
+	static const int CLOCK_BURST_PERIOD = 50;  // ms between clock samples until synced...
+	static const int CLOCK_PERIOD = 1000;      // ...and after
+	// a snapshot this many ticks behind the newest means a new match, as when
+	// the session was reaped and seated again, rather than a reordered datagram
+	static const uint32_t RESTART_TICKS = 256;
+
+	NetworkThread(rpc::client& client, const NetworkOptions& options);
+	~NetworkThread();
+
+	void start();
+	void stop();
+
+	// render thread; inputSeq numbers the frame for prediction (Prediction.h)
+	void submit(const Player& local, uint32_t inputSeq);
+	// newest reply received so far and when it arrived; false until the first one arrives
+	bool latest(SyncReply& reply, std::chrono::steady_clock::time_point* receivedAt = nullptr);
+	// queue a shot for the server to judge; the network thread sends it
+	void shoot(const Shot& shot);
+	// the match clock at local steady clock seconds; false until the clock is synced
+	bool matchTime(double local, double& time) const;
+	// match time of the start signal, 0 until the server has scheduled it
+	double startAt() const { return startTime.load(std::memory_order_relaxed); }
+
+	NetworkStats stats() const;
+
+private:
+	// a reply and the number of the publish that carried it
+	struct Published {
+		uint64_t seq;
+		std::chrono::steady_clock::time_point received;
+		SyncReply reply;
+	};
+	// the local player as of one render frame
+	struct Frame {
+		uint32_t seq;
+		Player player;
+	};
+	struct PendingEvent {
+		uint64_t publishedIn; // 0 until it went out with a publish
+		Event event;
+	};
+
+	void run();
+	void runClock();
+	void runTcp();
+	void runUdp();
+	bool openPoseChannel();
+	void renewToken();
+	bool waitForFirstFrame();
+	void addEvents(const std::vector<Event>& events);
+	void publish(SyncReply reply, std::chrono::steady_clock::time_point received);
+	void sendShots();
+
+	rpc::client& client;
+	NetworkOptions options;
+	std::thread worker;
+	std::thread clockWorker;
+	std::atomic<bool> running{ false };
+
+	TripleBuffer<Frame> outgoing;
+	TripleBuffer<Published> incoming;
+	bool haveReply = false;
+
+	// shots are rare, a lock is fine here
+	std::mutex shotLock;
+	std::vector<Shot> shots;
+
+	// events are resent with every reply until the render thread has seen them
+	std::vector<PendingEvent> unread;
+	std::atomic<uint64_t> consumed{ 0 }; // seq of the last publish the render thread read
+	uint64_t publishes = 0;
+	uint64_t lastTick = 0;
+
+	// opponent snapshots received, as baselines for the server's deltas
+	SnapshotRing baselines;
+	uint32_t ackTick = 0;
+
+	// pose channel
+	UdpSocket socket;
+	UdpAddress server;
+	uint32_t token = 0;
+
+	// owned by the clock thread; the render thread sees the published offset
+	ClockSync clock;
+	std::atomic<bool> clockSynced{ false };
+	std::atomic<double> clockOffset{ 0.0 };
+	std::atomic<double> clockRtt{ 0.0 };
+	std::atomic<double> startTime{ 0.0 };
+
+	std::atomic<uint64_t> frames{ 0 };
+	std::atomic<int64_t> renderWaitNs{ 0 };
+	std::atomic<uint64_t> sent{ 0 };
+	std::atomic<uint64_t> received{ 0 };
+	std::atomic<uint64_t> failed{ 0 };
+	std::atomic<int64_t> lastRttNs{ 0 };
+	std::atomic<uint64_t> bytesReceived{ 0 };
+	std::atomic<bool> udp{ false };
+	std::atomic<uint64_t> stale{ 0 };
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Single producer / single consumer hand-off of the latest value.
+// The producer always has a slot to write into and the consumer always has a
+// slot to read from, so neither side ever waits for the other; values the
+// consumer did not get to in time are simply overwritten.
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : middle(1), back(2), front(0) {}
+
+	// producer: fill the back slot, then publish it
+	T& writeSlot() { return slots[back]; }
+	void publish() {
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+	void publish(const T& value) {
+		writeSlot() = value;
+		publish();
+	}
+
+	// consumer: pick up the newest published value if there is one; returns
+	// whether the value changed since the previous call
+	bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	const T& read() const { return slots[front]; }
+
+private:
+	static const int INDEX = 3;
+	static const int FRESH = 4;
+
+	T slots[3];
+	std::atomic<int> middle; // slot index, plus FRESH when the producer has published since the last update
+	int back;  // producer only
+	int front; // consumer only
+};
+
+#endif
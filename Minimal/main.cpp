@@ -23,6 +23,7 @@ limitations under the License.
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <cstring>
 #include <Windows.h>
 
 #include <iostream>
@@ -32,7 +33,14 @@ limitations under the License.
 #include <glm/gtx/string_cast.hpp>
 
 // Shared struct
-#include "player.h"
+#include "Player.h"
+#include "Protocol.h"
+#include "NetworkThread.h"
+#include "InterpolationBuffer.h"
+#include "Prediction.h"
+#include "DuelSim.h"
+#include "Arena.h"
+#include "FixedStep.h"
 using std::string;
 
 
@@ -70,8 +78,11 @@ using std::string;
 #include <boost/circular_buffer.hpp>
 #include "Skybox.h"
 #include "Model.h"
+#include "ModelCache.h"
 #include "Mesh.h"
 #include "BoundingBox.h"
+#include "CollisionWorld.h"
+#include "Sweep.h"
 #include "irrKlang.h"
 
 // Import the most commonly used types into the default namespace
@@ -92,16 +103,9 @@ int frameLag = 0;
 int renderLag = 0;
 int last;
 bool isLeft = false;
-bool fire = false;
-bool finishFire;
-bool fired;
-bool pickedUp;
 bool soundPlayed;
 bool otherSoundPlayed;
-bool dead;
-bool gameStart;
 bool restartGame;
-bool wins;
 int frameCtr = 0;
 int frameHead = 0;
 int bulletCount = 0;
@@ -143,6 +147,30 @@ bool LT;
 // Other player struct 
 Player otherPlayer;
 int ID;
+// latest reply from the network thread
+Player remotePlayer;
+uint64_t lastTick = 0;
+// the opponent is drawn from this rather than straight from the newest reply
+InterpolationBuffer remoteBuffer;
+NetworkOptions networkOptions;
+// the server decides hits: the scene queues the shot, draw() hands it to the network thread
+Shot localShot;
+bool shotPending = false;
+// set from server events, consumed by the scene
+bool opponentHit = false;
+bool localHit = false;
+uint64_t diedTick = 0;
+uint64_t killedTick = 0;
+// the local fire/dead state reacts at once and is corrected by the server
+Predictor prediction;
+// the server's match clock as of this frame, and when the duel starts on it
+bool matchClock = false;
+double matchNow = 0.0;
+double matchStartAt = 0.0;
+// pickup, bullets and hits; the scene steps it and draws what it holds
+DuelSim duel;
+// the duel runs at its own rate, not the headset's; hitches over 0.1 s are dropped
+FixedStep duelClock(1.0 / DuelSim::STEP_RATE, DuelSim::STEP_RATE / 10);
 
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -592,6 +620,10 @@ private:
 	uvec2 _renderTargetSize;
 	uvec2 _mirrorSize;
 
+protected:
+	// owned by run(); draw() only exchanges data with it and never waits on the network
+	NetworkThread* network{ nullptr };
+
 public:
 
 	RiftApp()
@@ -630,6 +662,20 @@ public:
 		ID = 1;
 	}
 
+	int run(rpc::client &c) override
+	{
+		NetworkThread net(c, networkOptions);
+		network = &net;
+		net.start();
+		int result = GlfwApp::run(c);
+		net.stop();
+		network = nullptr;
+		// give the seat back now instead of after the server's idle timeout
+		auto leave = c.async_call("leave");
+		leave.wait_for(std::chrono::seconds(1));
+		return result;
+	}
+
 protected:
 	GLFWwindow* createRenderingTarget(uvec2& outSize, ivec2& outPosition) override
 	{
@@ -715,6 +761,9 @@ protected:
 
 	void draw(rpc::client &c) final override
 	{
+		double frameStart = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		matchClock = network->matchTime(frameStart, matchNow);
+		matchStartAt = network->startAt();
 
 		//controller
 		ovrInputState inputState;
@@ -778,6 +827,7 @@ protected:
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
 		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, curTexId, 0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		simulate(frameStart);
 		ovr::for_each_eye([&](ovrEyeType eye) {
 			renderEye[eye] = lastEye[eye];
 			if (getBState() == 0) {
@@ -847,11 +897,47 @@ protected:
 		otherPlayer.headPos = headPos;
 		otherPlayer.headrotation = -headOri;
 		otherPlayer.shootDir = -forward;
-		c.call("in", ID, otherPlayer);
-		Player player = c.call("out", ID).as<Player>();
-		otherPlayer = player;
+		// the flags are ours too, not whatever the opponent's sample left in them
+		otherPlayer.fire = duel.fire && duel.gameStart && duel.pickedUp;
+		otherPlayer.dead = duel.dead;
+		network->submit(otherPlayer, prediction.apply(otherPlayer));
+		SyncReply reply;
+		std::chrono::steady_clock::time_point received;
+		double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		if (network->latest(reply, &received)) {
+			if (reply.tick < lastTick)
+				diedTick = killedTick = 0; // new match, new tick numbers
+			if (reply.tick != lastTick && reply.opponent)
+				remoteBuffer.push(reply.time, std::chrono::duration<double>(received.time_since_epoch()).count(), reply.other);
+			if (reply.tick != lastTick)
+				prediction.reconcile(reply.inputSeq, reply.self);
+			lastTick = reply.tick;
+			remotePlayer = reply.other;
+			// events repeat until a newer reply replaces them
+			for (const Event& e : reply.events) {
+				if (e.type == EVENT_DIED && e.tick > diedTick) {
+					diedTick = e.tick;
+					opponentHit = true;
+				}
+				else if (e.type == EVENT_KILLED && e.tick > killedTick) {
+					killedTick = e.tick;
+					localHit = true;
+				}
+			}
+		}
+		otherPlayer = remoteBuffer.ready() ? remoteBuffer.sample(now) : remotePlayer;
+		// a shot the server says we could not have taken is taken back
+		if (duel.fire && prediction.predicted().dead) {
+			duel.fire = false;
+			shotPending = false;
+		}
+		if (shotPending) {
+			network->shoot(localShot);
+			shotPending = false;
+		}
 	}
 
+	virtual void simulate(double now) = 0;
 	virtual void renderScene(const glm::mat4& projection, const glm::mat4& headPose, bool left) = 0;
 	virtual int getAState() = 0;
 	virtual int getBState() = 0;
@@ -903,28 +989,38 @@ class Scene
 	std::unique_ptr<Skybox> skybox_r;
 	std::unique_ptr<Skybox> skybox;
 
-	Model* hand;
-	Model* otherHand;
-	Model* gun;
-	Model* bullet;
+	// from the app's ModelCache, so both players' copies share one load
+	std::shared_ptr<Model> hand;
+	std::shared_ptr<Model> otherHand;
+	std::shared_ptr<Model> gun;
+	std::shared_ptr<Model> bullet;
 	std::vector<Model*> bullets;
+	// owns the bounding boxes below
+	CollisionWorld world;
 	BoundingBox* modelBounding, *bulletBounding,*handBounding,*otherHandBounding,*gunBox,*otherGunBox;
 
-	Model* othergun;
-	Model* otherbullet;
+	std::shared_ptr<Model> othergun;
+	std::shared_ptr<Model> otherbullet;
 
-	Model* body;
-	Model* otherBody;
+	std::shared_ptr<Model> body;
+	std::shared_ptr<Model> otherBody;
 	BoundingBox* otherModelBounding, *otherbulletBounding;
+	// where the bullets' boxes were at the last collision step, and their
+	// steps left in flight then and as last drawn (0 while in the hand)
+	glm::vec3 lastBulletAt, lastOtherBulletAt;
+	int lastBulletLife = 0, lastOtherBulletLife = 0;
+	int bulletLife = 0, otherBulletLife = 0;
 
 	Light light;
 
+	// the bullets one step back, and as drawn this frame between that and now
+	SimBullet lastBullet, lastOtherBullet;
+	SimBullet drawnBullet, drawnOtherBullet;
+
 
 	bool shotPlayed;
 	
 	bool signalPlayed = false;
-	
-	chrono::time_point<chrono::system_clock> startTime;
 
 	const unsigned int GRID_SIZE{ 5 };
 
@@ -938,7 +1034,7 @@ public:
 
 
 
-	Scene()
+	Scene(ModelCache& models)
 	{
 		// Create two cube
 		instance_positions.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -0.3)));
@@ -954,23 +1050,24 @@ public:
 		modelShader = LoadShaders(MODEL_VERT, MODEL_FRAG);
 		//models
 		//cube = std::make_unique<TexturedCube>("cube");
-		gun = new Model("model/gun/schofield-pistol-low.obj");
-		gunBox = new BoundingBox(gun->boundingbox, gun->boxVertices);
-		othergun = new Model("model/gun/schofield-pistol-low.obj");
-		body = new Model("model/face/face.obj");
-		modelBounding = new BoundingBox(body->boundingbox, body->boxVertices);
-		otherBody = new Model("model/face/face.obj");
-		otherModelBounding = new BoundingBox(otherBody->boundingbox, otherBody->boxVertices);
+		gun = models.get("model/gun/schofield-pistol-low.obj");
+		gunBox = world.add(gun->boundingbox, gun->boxVertices);
+		othergun = models.get("model/gun/schofield-pistol-low.obj");
+		body = models.get("model/face/face.obj");
+		modelBounding = world.add(body->boundingbox, body->boxVertices);
+		otherBody = models.get("model/face/face.obj");
+		otherModelBounding = world.add(otherBody->boundingbox, otherBody->boxVertices);
 		/*for (int i = 0; i < 6; i++) {
 			bullets[i] = new Model("sphere.obj");
 		}*/
-		hand = new Model("sphere.obj");
-		handBounding = new BoundingBox(hand->boundingbox, hand->boxVertices);
-		otherHand = new Model("sphere.obj");
-		otherHandBounding = new BoundingBox(otherHand->boundingbox, otherHand->boxVertices);
+		hand = models.get("sphere.obj");
+		handBounding = world.add(hand->boundingbox, hand->boxVertices);
+		otherHand = models.get("sphere.obj");
+		otherHandBounding = world.add(otherHand->boundingbox, otherHand->boxVertices);
+		duel.setBoxes(gun->boxVertices, hand->boxVertices);
+		lastBullet = drawnBullet = duel.bullet;
+		lastOtherBullet = drawnOtherBullet = duel.otherBullet;
 
-		bullet = new Model("sphere.obj");
-		bullet->toWorld *= glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
 		// 10m wide sky box: size doesn't matter though
 		skybox_l = std::make_unique<Skybox>("skybox");
 		skybox_l->toWorld = glm::scale(glm::mat4(1.0f), glm::vec3(10.0f));
@@ -979,10 +1076,14 @@ public:
 		skybox = std::make_unique<Skybox>("skybox");
 		skybox->toWorld = glm::scale(glm::mat4(1.0f), glm::vec3(5.0f));
 		//initialize bounding boxes
-		bullet = new Model("sphere.obj");
-		bulletBounding = new BoundingBox(bullet->boundingbox, bullet->boxVertices);
-		otherbullet = new Model("sphere.obj");
-		otherbulletBounding = new BoundingBox(otherbullet->boundingbox, otherbullet->boxVertices);
+		bullet = models.get("sphere.obj");
+		bulletBounding = world.add(bullet->boundingbox, bullet->boxVertices);
+		otherbullet = models.get("sphere.obj");
+		otherbulletBounding = world.add(otherbullet->boundingbox, otherbullet->boxVertices);
+		bulletBounding->swept = true;
+		otherbulletBounding->swept = true;
+		lastBulletAt = centre(bulletBounding);
+		lastOtherBulletAt = centre(otherbulletBounding);
 		//TODO
 		//temp model bouding box
 
@@ -999,16 +1100,11 @@ public:
 
 		SoundEngine2->setSoundVolume(0.2);
 		SoundEngine2->play2D(BGM, GL_FALSE);
-		//set timer
-		startTime = chrono::system_clock::now();
 
 
 	}
 
 	~Scene() {
-		delete(gun);
-		delete(bulletBounding);
-		delete(modelBounding);
 		delete(SoundEngine1);
 		delete(SoundEngine2);
 		glDeleteProgram(shaderID);
@@ -1018,12 +1114,124 @@ public:
 		glDeleteProgram(modelShader);
 	}
 
+	static glm::vec3 centre(const BoundingBox* box)
+	{
+		Aabb b = box->bounds();
+		return (b.lo + b.hi) * 0.5f;
+	}
+
+	// Whether a bullet's path since the last step crosses a model's mesh, in
+	// the model's own space
+	static bool crossesMesh(const glm::vec3& from, const BoundingBox* bulletBox, const BoundingBox* modelBox, const Model* model)
+	{
+		glm::mat4 toModel = glm::inverse(modelBox->toWorld);
+		glm::vec3 a(toModel * glm::vec4(from, 1.0f));
+		glm::vec3 b(toModel * glm::vec4(centre(bulletBox), 1.0f));
+		float toi;
+		return model->bvh.segment(a, b, toi);
+	}
+
+	// Whether a bullet's path since the last step passes through another box.
+	// The box is grown by the bullet's half size so its centre's path will do.
+	static bool crossesBox(const glm::vec3& from, const BoundingBox* bulletBox, const BoundingBox* box)
+	{
+		Aabb bullet = bulletBox->bounds();
+		glm::vec3 half = (bullet.hi - bullet.lo) * 0.5f;
+		Aabb target = box->bounds();
+		float toi;
+		return SweepBox(from, centre(bulletBox), target.lo - half, target.hi + half, toi);
+	}
+
+	// Whether a bullet flew straight through the step: on one shot, or out
+	// of the hand, where its box waits between shots. Otherwise its box went
+	// back to the hand in between, and the path from the last step would cross
+	// whatever lies between the hand and where the bullet was.
+	static bool flewStep(int lastLife, int life)
+	{
+		return life > 0 && (lastLife == 0 || life <= lastLife);
+	}
+
+	// Narrow phase for the collision world. The bullets are swept, so they
+	// come paired with everything their path crossed: a bullet and a body
+	// only touch when that path went through the body's mesh, not just its
+	// box, a bullet and anything else when it went through the other's box,
+	// and the rest when the boxes turned with the models overlap
+	bool touches(BoundingBox* a, BoundingBox* b)
+	{
+		if (b == bulletBounding || b == otherbulletBounding)
+			std::swap(a, b);
+		if (a == bulletBounding && b == otherModelBounding)
+			return flewStep(lastBulletLife, bulletLife) && crossesMesh(lastBulletAt, a, b, otherBody.get());
+		if (a == otherbulletBounding && b == modelBounding)
+			return flewStep(lastOtherBulletLife, otherBulletLife) && crossesMesh(lastOtherBulletAt, a, b, body.get());
+		if (a == bulletBounding && flewStep(lastBulletLife, bulletLife))
+			return crossesBox(lastBulletAt, a, b);
+		if (a == otherbulletBounding && flewStep(lastOtherBulletLife, otherBulletLife))
+			return crossesBox(lastOtherBulletAt, a, b);
+		return ObbOverlap(a->orientedBounds(), b->orientedBounds());
+	}
+
+	// the duel steps due by now, before either eye is drawn
+	void simulate(double now)
+	{
+		// flags the boxes where the last frame drew them, for showBounding
+		world.step([this](BoundingBox* a, BoundingBox* b) { return touches(a, b); });
+		lastBulletAt = centre(bulletBounding);
+		lastOtherBulletAt = centre(otherbulletBounding);
+		lastBulletLife = bulletLife;
+		lastOtherBulletLife = otherBulletLife;
+
+		DuelInput in;
+		in.clockSynced = matchClock;
+		in.now = matchNow;
+		in.startAt = matchStartAt;
+		in.headPos = headPos;
+		in.handPos = handPos;
+		in.handRotation = handRotationMtx;
+		in.shootDir = shootDir;
+		in.grip = RHPressed;
+		in.opponentHit = opponentHit;
+		in.localHit = localHit;
+		int steps = duelClock.advance(now);
+		for (int i = 0; i < steps; i++) {
+			lastBullet = duel.bullet;
+			lastOtherBullet = duel.otherBullet;
+			unsigned events = duel.step(in, otherPlayer);
+			// hits are taken once; the frame's poses hold for all its steps
+			in.opponentHit = opponentHit = false;
+			in.localHit = localHit = false;
+			if (events & DUEL_SHOT) {
+				// aimed at the opponent as drawn, which is remoteBuffer.time() on the server clock
+				localShot.firedAt = matchNow;
+				localShot.viewTime = remoteBuffer.time();
+				localShot.origin = handPos;
+				localShot.direction = shootDir;
+				shotPending = true;
+			}
+			if ((events & DUEL_FIRING) && !soundPlayed) {
+				SoundEngine2->setSoundVolume(0.2);
+				SoundEngine2->play2D(FIRING_BGM, GL_TRUE);
+				soundPlayed = true;
+			}
+			if (events & DUEL_WON) {
+				cout << "u win!" << endl;
+				SoundEngine4->setSoundVolume(0.3);
+				SoundEngine4->play2D("sound/win.mp3", GL_FALSE);
+			}
+			if (events & DUEL_LOST) {
+				cout << "u lose!" << endl;
+				SoundEngine4->setSoundVolume(0.3);
+				SoundEngine4->play2D("sound/lose.mp3", GL_FALSE);
+			}
+		}
+		drawnBullet = Interpolate(lastBullet, duel.bullet, duelClock.alpha());
+		drawnOtherBullet = Interpolate(lastOtherBullet, duel.otherBullet, duelClock.alpha());
+	}
+
 	void render(const glm::mat4& projection, const glm::mat4& view, bool left)
 	{
-		startGame();
-		if (!dead) {
-			//gameStart = true;
-			if (gameStart) {
+		if (!duel.dead) {
+			if (duel.gameStart) {
 				SoundEngine3->setSoundVolume(0.3);
 				if (!signalPlayed) {
 					SoundEngine3->play2D("sound/signal.mp3", GL_FALSE);
@@ -1055,15 +1263,12 @@ public:
 		
 
 			
-			if (!pickedUp) {
+			if (!duel.pickedUp) {
 				glm::mat4 inverse_init = glm::translate(glm::mat4(1.0f), -handPos);
-				glm::mat4 scale_init = glm::scale(glm::mat4(1.0f), glm::vec3(0.08f, 0.08f, 0.08f));
-				glm::mat4 initGunPos = glm::translate(glm::mat4(1.0f), glm::vec3(headPos.x + 0.2f, headPos.y - 0.4f, headPos.z));
+				gunBox->toWorld = duel.gunBox;
+				glm::mat4 scale_init = glm::scale(glm::mat4(1.0f), glm::vec3(0.0005f, 0.0005f, 0.0005f));
+				glm::mat4 initGunPos = glm::translate(glm::mat4(1.0f), glm::vec3(headPos.x +0.175, headPos.y - 0.375f, headPos.z));
 				glm::mat4 initGunMatrix = initGunPos * scale_init*inverse_init;
-				gunBox->toWorld = initGunMatrix;
-				scale_init = glm::scale(glm::mat4(1.0f), glm::vec3(0.0005f, 0.0005f, 0.0005f));
-				initGunPos = glm::translate(glm::mat4(1.0f), glm::vec3(headPos.x +0.175, headPos.y - 0.375f, headPos.z));
-				initGunMatrix = initGunPos * scale_init*inverse_init;
 				initGunMatrix = initGunMatrix * glm::rotate(glm::mat4(1.0), 1.01f* glm::pi<float>(), glm::vec3(0, 1, -1));
 				glUniformMatrix4fv(model, 1, GL_FALSE, &initGunMatrix[0][0]);
 				gun->Draw(modelShader);
@@ -1081,7 +1286,7 @@ public:
 
 
 
-			if (!pickedUp) {
+			if (!duel.pickedUp) {
 				setUpLight();
 				//draw hand 
 				glm::mat4 inverse = glm::translate(glm::mat4(1.0f), -handPos);
@@ -1099,12 +1304,7 @@ public:
 				glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 				glUniformMatrix4fv(model, 1, GL_FALSE, &modelMatrix[0][0]);
 				hand->Draw(modelShader);
-				handBounding->toWorld = modelMatrix;
-			}
-			if (RHPressed&&gameStart) {
-				if (checkcollision(gunBox, handBounding)) {
-					pickedUp = true;
-				}
+				handBounding->toWorld = duel.handBox;
 			}
 
 			
@@ -1112,7 +1312,7 @@ public:
 
 			//after picked up
 			//draw gun
-			if (pickedUp) {
+			if (duel.pickedUp) {
 				glm::mat4 inverse_gun = glm::translate(glm::mat4(1.0f), -handPos);
 				glm::mat4 T_gun = glm::translate(glm::mat4(1.0f), glm::vec3(handPos.x, handPos.y - 0.01f, handPos.z));
 				glm::mat4 scale_gun = glm::scale(glm::mat4(1.0f), glm::vec3(0.001f, 0.001f, 0.001f));
@@ -1129,17 +1329,16 @@ public:
 				glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 				glUniformMatrix4fv(model, 1, GL_FALSE, &modelMatrix_gun[0][0]);
 				gun->Draw(modelShader);
-				otherPlayer.pickedUp = true;
 			}
 
 
 			//set bullet position when not firing
 			glUseProgram(bulletShader);
-			if (!fire) {
+			if (!duel.fire) {
 				glm::mat4 inverse_b = glm::translate(glm::mat4(1.0f), -handPos);
 				glm::mat4 T_b = glm::translate(glm::mat4(1.0f), handPos);
 				glm::mat4 scale_b = glm::scale(glm::mat4(1.0f), glm::vec3(0.05f, 0.05f, 0.05f));
-				glm::mat4 modelMatrix_b = T_b * handRotationMtx*scale_b*inverse_b*bullet->toWorld;
+				glm::mat4 modelMatrix_b = T_b * handRotationMtx*scale_b*inverse_b*drawnBullet.toWorld;
 				curPlayerBullet = modelMatrix_b;
 				uProjection = glGetUniformLocation(bulletShader, "projection");
 				uModelview = glGetUniformLocation(bulletShader, "view");
@@ -1149,22 +1348,19 @@ public:
 				glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 				glUniformMatrix4fv(model, 1, GL_FALSE, &modelMatrix_b[0][0]);
 				//bullet->Draw(bulletShader);
-				bullet->viewdir = shootDir;
 				//bullet->toWorld = modelMatrix;
 				//cout << to_string(shootDir) << endl;
 				bulletBounding->toWorld = modelMatrix_b;
+				bulletLife = 0;
 
 			}
 			//if firing
-			else if (fire&&gameStart&&pickedUp) {
-				otherPlayer.fire = true;
-				finishFire = false;
-
+			else if (duel.gameStart&&duel.pickedUp) {
 				//bullet shoot
 				glm::mat4 inverse_bs = glm::translate(glm::mat4(1.0f), -handPos);
 				glm::mat4 T_bs = glm::translate(glm::mat4(1.0f), handPos);
 				glm::mat4 scale_bs = glm::scale(glm::mat4(1.0f), glm::vec3(0.05f, 0.05f, 0.05f));
-				glm::mat4 modelMatrix_bs = T_bs * scale_bs*inverse_bs*bullet->toWorld;
+				glm::mat4 modelMatrix_bs = T_bs * scale_bs*inverse_bs*drawnBullet.toWorld;
 				curPlayerBullet = modelMatrix_bs;
 				uProjection = glGetUniformLocation(bulletShader, "projection");
 				uModelview = glGetUniformLocation(bulletShader, "view");
@@ -1181,21 +1377,15 @@ public:
 				//bullet->viewdir = shootDir;
 				//bullet->viewdir = shootDir;
 
-				bullet->fire();
 				//bulletBounding->toWorld*= glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
 				bulletBounding->toWorld = modelMatrix_bs;
+				bulletLife = drawnBullet.duration;
 				//bulletBounding->toWorld = modelMatrix;
-				if (!soundPlayed) {
-					SoundEngine2->setSoundVolume(0.2);
-					SoundEngine2->play2D(FIRING_BGM, GL_TRUE);
-					soundPlayed = true;
-				}
 				//SoundEngine1->stopAllSounds();
-				fired = true;
 
 
 			}
-			if (finishFire) {
+			if (duel.finishFire) {
 				glUseProgram(bulletShader);
 				glm::mat4 inverse_finish = glm::translate(glm::mat4(1.0f), -handPos);
 				glm::mat4 T_finish = glm::translate(glm::mat4(1.0f), handPos);
@@ -1209,13 +1399,11 @@ public:
 				glUniformMatrix4fv(uProjection, 1, GL_FALSE, &projection[0][0]);
 				glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 				glUniformMatrix4fv(model, 1, GL_FALSE, &modelMatrix_finish[0][0]);
-				bullet->toWorld = modelMatrix_finish;
 				//bullet->Draw(bulletShader);
 				bulletBounding->toWorld = modelMatrix_finish;
+				bulletLife = 0;
 				//delete(bullet);
 				//bullet = new Model("sphere.obj");
-				bullet->duration = 400;
-				fired = false;
 				// cout<<"finish"<<endl;
 
 				 //bullet->toWorld = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
@@ -1225,7 +1413,7 @@ public:
 			//other bullet
 
 
-			if (RT&&bullet->duration <= 400 && bullet->duration >= 350) {
+			if (RT&&duel.bullet.duration <= 400 && duel.bullet.duration >= 350) {
 
 				SoundEngine1->setSoundVolume(0.3);
 
@@ -1242,10 +1430,6 @@ public:
 
 
 			}
-			if (bullet->duration == 0) {
-				finishFire = true;
-				fire = false;
-			}
 		}
 
 
@@ -1253,20 +1437,8 @@ public:
 		/***************************************************************************************************/
 		//draw other player
 		setUpLight();
-		glm::mat4 o_inverse_model = glm::translate(glm::mat4(1.0f), -otherPlayer.headPos);
-		//cout << to_string(headPos) << endl;
-		//T = glm::translate(glm::mat4(1.0f), headPos);
-		//for gun picking if we are gonna implement that
-		glm::mat4 o_T_model = glm::translate(glm::mat4(1.0f), glm::vec3(otherPlayer.headPos.x, otherPlayer.headPos.y, otherPlayer.headPos.z + 1.5f));
-		glm::mat4 o_T_head = glm::translate(glm::mat4(1.0f), glm::vec3(otherPlayer.headPos.x, otherPlayer.headPos.y, otherPlayer.headPos.z));
-		glm::mat4 o_scale_model = glm::scale(glm::mat4(1.0f), glm::vec3(0.3f, 0.3f, 0.3f));
-		glm::mat4 o_modelMatrix_model = o_T_model * o_scale_model*o_inverse_model;
-		glm::mat4 o_bounding_model = o_T_head * o_scale_model*o_inverse_model;
-
-		o_modelMatrix_model *= glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -20.0f));
-		o_modelMatrix_model *= glm::mat4_cast(otherPlayer.headrotation);
-		o_bounding_model *= glm::mat4_cast(otherPlayer.headrotation);
-		o_modelMatrix_model *= glm::rotate(glm::mat4(1.0), 1.0f* glm::pi<float>(), glm::vec3(0, 1, 0));
+		// the head where the server tests shots at it (Arena.h)
+		glm::mat4 o_modelMatrix_model = arena::OpponentHead(otherPlayer.headPos, otherPlayer.headrotation);
 		uProjection = glGetUniformLocation(modelShader, "projection");
 		uModelview = glGetUniformLocation(modelShader, "view");
 		model = glGetUniformLocation(modelShader, "model");
@@ -1274,7 +1446,7 @@ public:
 		glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 		glUniformMatrix4fv(model, 1, GL_FALSE, &o_modelMatrix_model[0][0]);
 		otherModelBounding->toWorld = o_modelMatrix_model;
-		if (wins) {
+		if (duel.wins) {
 			o_modelMatrix_model *= glm::scale(glm::mat4(1.0f), glm::vec3(0.003f, 0.003f, 0.003f));
 			uProjection = glGetUniformLocation(modelShader, "projection");
 			uModelview = glGetUniformLocation(modelShader, "view");
@@ -1316,7 +1488,7 @@ public:
 			glm::mat4 o_inverse_b = glm::translate(glm::mat4(1.0f), -otherPlayer.handpos);
 			glm::mat4 o_T_b = glm::translate(glm::mat4(1.0f), otherPlayer.handpos);
 			glm::mat4 o_scale_b = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
-			glm::mat4 o_modelMatrix_b = o_T_b *o_scale_b*o_inverse_b*otherbullet->toWorld;
+			glm::mat4 o_modelMatrix_b = o_T_b *o_scale_b*o_inverse_b*drawnOtherBullet.toWorld;
 			o_modelMatrix_b*=  glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -10.0f));
 			//curPlayerBullet = o_modelMatrix_b;
 			uProjection = glGetUniformLocation(bulletShader, "projection");
@@ -1327,21 +1499,19 @@ public:
 			glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 			glUniformMatrix4fv(model, 1, GL_FALSE, &o_modelMatrix_b[0][0]);
 			otherbullet->Draw(bulletShader);
-			otherbullet->viewdir = otherPlayer.shootDir;
 			//bullet->toWorld = modelMatrix;
 			//cout << to_string(shootDir) << endl;
 			otherbulletBounding->toWorld = o_modelMatrix_b;
+			otherBulletLife = 0;
 
 		}
 		//if firing
-		else if (otherPlayer.fire&&gameStart&&otherPlayer.pickedUp) {
-			otherPlayer.finishFire = false;
-			otherPlayer.fired = true;
+		else if (duel.gameStart&&otherPlayer.pickedUp) {
 			//bullet shoot
 			glm::mat4 o_inverse_bs = glm::translate(glm::mat4(1.0f), -otherPlayer.handpos);
 			glm::mat4 o_T_bs = glm::translate(glm::mat4(1.0f), otherPlayer.handpos);
 			glm::mat4 o_scale_bs = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
-			glm::mat4 o_modelMatrix_bs = o_T_bs * o_scale_bs*o_inverse_bs*otherbullet->toWorld;
+			glm::mat4 o_modelMatrix_bs = o_T_bs * o_scale_bs*o_inverse_bs*drawnOtherBullet.toWorld;
 			o_modelMatrix_bs *= glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -10.0f));
 			otherPlayerBullet = o_modelMatrix_bs;
 			uProjection = glGetUniformLocation(bulletShader, "projection");
@@ -1359,26 +1529,13 @@ public:
 			//bullet->viewdir = shootDir;
 			//bullet->viewdir = shootDir;
 
-			otherbullet->fire2();
 			//bulletBounding->toWorld*= glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
 			otherbulletBounding->toWorld = o_modelMatrix_bs;
+			otherBulletLife = drawnOtherBullet.duration;
 			//bulletBounding->toWorld = modelMatrix;
-			if (!soundPlayed) {
-				SoundEngine2->setSoundVolume(0.2);
-				SoundEngine2->play2D(FIRING_BGM, GL_TRUE);
-				soundPlayed = true;
-			}
 			//SoundEngine1->stopAllSounds();
 
 
-		}
-		if (otherPlayer.fired) {
-			SoundEngine1->setSoundVolume(0.3);
-
-			
-			//SoundEngine1->play2D(SOUND_PATH, GL_FALSE);
-			
-			otherPlayer.fired = false;
 		}
 		if (otherPlayer.finishFire) {
 			glUseProgram(bulletShader);
@@ -1395,12 +1552,11 @@ public:
 			glUniformMatrix4fv(uProjection, 1, GL_FALSE, &projection[0][0]);
 			glUniformMatrix4fv(uModelview, 1, GL_FALSE, &view[0][0]);
 			glUniformMatrix4fv(model, 1, GL_FALSE, &o_modelMatrix_finish[0][0]);
-			otherbullet->toWorld = o_modelMatrix_finish;
 			//bullet->Draw(bulletShader);
 			otherbulletBounding->toWorld = o_modelMatrix_finish;
+			otherBulletLife = 0;
 			//delete(bullet);
 			//bullet = new Model("sphere.obj");
-			otherbullet->duration = 400;
 			// cout<<"finish"<<endl;
 
 			 //bullet->toWorld = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
@@ -1408,12 +1564,6 @@ public:
 
 
 
-		if (otherbullet->duration <= 0) {
-			otherPlayer.finishFire = true;
-			otherPlayer.fire = false;
-		}
-
-
 
 
 
@@ -1435,31 +1585,6 @@ public:
 		}
 
 
-
-		//set lighting and model shaders
-		//for the model
-
-		
-		if (checkcollision(bulletBounding, otherModelBounding)) {
-			cout << "u win!" << endl;
-			wins = true;
-			SoundEngine4->setSoundVolume(0.3);
-			SoundEngine4->play2D("sound/win.mp3", GL_FALSE);
-			otherPlayer.dead = true;
-		}
-		if (otherPlayer.dead) {
-			otherPlayer.fire = false;
-		}
-		if (checkcollision(otherbulletBounding, modelBounding)) {
-			wins = false;
-			cout << "u lose!" << endl;
-			SoundEngine4->setSoundVolume(0.3);
-			SoundEngine4->play2D("sound/lose.mp3", GL_FALSE);
-			dead = true;
-			fire = false;
-		}
-		
-
 	}
 
 	void setUpLight() {
@@ -1474,45 +1599,6 @@ public:
 
 
 
-	}
-
-	void startGame() {
-		int max = 11;
-		int min = 5;
-		auto endTime = chrono::system_clock::now();
-		srand(time(NULL));
-		int randNum = rand() % (max - min + 1) + min;
-		if (chrono::duration_cast<chrono::seconds>(endTime - startTime).count() == 10) {
-			gameStart = true;
-		}
-	}
-
-	bool checkcollision(BoundingBox* box1,BoundingBox* box2) {
-		std::vector<float> bound1 = box1->getBoundary();
-		//TODO
-		//model bounding hasnt been initialized since models are not done yet
-		std::vector<float> bound2 = box2->getBoundary();
-
-		// check bound
-		if (bound1[0] > bound2[1] && bound1[2] > bound2[3] && bound1[4] > bound2[5] &&
-			bound1[1] < bound2[0] && bound1[3] < bound2[2] && bound1[5] < bound2[4]) {
-			box1->collisionflag = true;
-			box2->collisionflag = true;
-			//cout << "touch" << endl;
-			//TODO
-			return true;
-			//need a new model
-			//Model->dying=true;
-		}
-		else {
-			box1->collisionflag = false;
-			box2->collisionflag = false;
-			return false;
-		}
-
-
-
-
 	}
 
 };
@@ -1520,6 +1606,8 @@ public:
 // An example application that renders a simple cube
 class ExampleApp : public RiftApp
 {
+	// outlives the scenes, which take their models from it
+	ModelCache models;
 	std::shared_ptr<Scene> scene;
 
 
@@ -1535,15 +1623,15 @@ protected:
 		glClearColor(0.2f, 0.2f, 0.2f, 0.0f);
 		glEnable(GL_DEPTH_TEST);
 		ovr_RecenterTrackingOrigin(_session);
-		scene = std::shared_ptr<Scene>(new Scene());
+		scene = std::shared_ptr<Scene>(new Scene(models));
 		std::cout << "Tracking lag: " << frameLag << " frames" << std::endl;
 		std::cout << "Rendering delay : " << renderLag << " frames" << std::endl;
-		if (wins || dead) {
+		if (duel.wins || duel.dead) {
 			restartGame = true;
 		}
 		if (restartGame) {
-			scene.reset();
-			scene= std::shared_ptr<Scene>(new Scene());
+			// the old scene goes after the new one has taken its models
+			scene= std::shared_ptr<Scene>(new Scene(models));
 			restartGame = false;
 		}
 	}
@@ -1588,9 +1676,9 @@ protected:
 			}
 			//index
 		
-				if (inputState.IndexTrigger[ovrHand_Right] > 0.5f&&gameStart&&pickedUp) {
+				if (inputState.IndexTrigger[ovrHand_Right] > 0.5f&&duel.gameStart&&duel.pickedUp) {
 					scene->RTPressed = true;
-					fire = true;
+					duel.pullTrigger();
 
 				}
 
@@ -1619,7 +1707,7 @@ protected:
 			}
 
 			//hand
-			if (inputState.HandTrigger[ovrHand_Right] > 0.5f&&gameStart) scene->RHPressed = true;
+			if (inputState.HandTrigger[ovrHand_Right] > 0.5f&&duel.gameStart) scene->RHPressed = true;
 			else if (scene->RHPressed) {
 
 
@@ -1630,6 +1718,21 @@ protected:
 
 
 				std::cout << "Rendering delay : " << renderLag << " frames" << std::endl;
+				NetworkStats net = network->stats();
+				std::cout << "Network (" << (net.udp ? "udp" : "tcp") << "): " << net.received << "/" << net.sent << " replies, "
+					<< net.stale << " stale, " << net.failed << " failed, rtt "
+					<< net.lastRttMs << " ms, " << (net.received ? net.bytesReceived / net.received : 0) << " bytes/reply, render thread waited "
+					<< net.renderWaitMs << " ms over " << net.frames << " frames" << std::endl;
+				std::cout << "Clock: " << (net.clockSynced ? "synced" : "not synced") << ", offset " << net.clockOffsetMs
+					<< " ms, rtt " << net.clockRttMs << " ms, start at " << matchStartAt << " s, now " << matchNow << " s" << std::endl;
+				InterpolationStats interp = remoteBuffer.stats();
+				std::cout << "Interpolation: " << interp.depth << " snapshots buffered, delay " << interp.delayMs << " ms, jitter "
+					<< interp.jitterMs << " ms, " << interp.underruns << " underruns (" << interp.frozen << " frozen), "
+					<< interp.late << " late" << std::endl;
+				std::cout << "Prediction: " << prediction.pending() << " inputs unconfirmed, "
+					<< prediction.mispredictions() << " corrections" << std::endl;
+				std::cout << "Duel: " << DuelSim::STEP_RATE << " steps/s, " << duelClock.dropped()
+					<< " dropped to hitches" << std::endl;
 				scene->LHPressed = false;
 			}
 
@@ -1676,6 +1779,11 @@ protected:
 	}
 
 
+	void simulate(double now) override
+	{
+		scene->simulate(now);
+	}
+
 	void renderScene(const glm::mat4& projection, const glm::mat4& headPose, bool left) override
 	{
 		curPose = headPose;
@@ -1726,7 +1834,21 @@ protected:
 int main(int argc, char** argv)
 {
 
-	rpc::client c("128.54.70.59", 8050);
+	networkOptions.host = "128.54.70.59";
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--server") && i + 1 < argc)
+			networkOptions.host = argv[++i];
+		else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+			networkOptions.port = (uint16_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--udp-port") && i + 1 < argc)
+			networkOptions.udpPort = (uint16_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--tcp-only"))
+			networkOptions.udp = false;
+		else if (!strcmp(argv[i], "--udp-loss") && i + 1 < argc)
+			networkOptions.udpLoss = atof(argv[++i]); // fraction of poses to drop, for testing
+	}
+
+	rpc::client c(networkOptions.host, networkOptions.port);
 	std::cout << "Connected" << std::endl;
 
 	int result = -1;
@@ -0,0 +1,96 @@
+#ifndef IMPAIRMENT_H
+#define IMPAIRMENT_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// What one direction of a link does to the traffic going through it.
+// Delays are one way, so a round trip sees them twice.
+struct ImpairmentConfig {
+	double latencyMs = 0.0;    // added to every packet
+	double jitterMs = 0.0;     // uniform extra delay in [0, jitter]
+	double loss = 0.0;         // fraction of packets lost
+	double reorder = 0.0;      // fraction of datagrams held back so later ones overtake them
+	double reorderMs = 10.0;   // how long those are held back
+	double bandwidth = 0.0;    // bytes per second, 0 for unlimited
+	double retransmitMs = 200.0; // what a lost tcp segment costs instead
+};
+
+struct ImpairmentStats {
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t lost;       // datagrams dropped, or segments delayed as retransmitted
+	uint64_t reordered;
+};
+
+// Decides when (and whether) a packet leaves. Datagrams can be dropped and
+// overtake each other. A stream cannot: a lost segment stalls everything behind
+// it for a retransmission timeout, which is what tcp loss looks like to rpclib.
+// Seeded, so a run with the same traffic and seed impairs it the same way.
+// One instance per direction; only counters() may be called from other threads.
+class Impairment {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	Impairment(const ImpairmentConfig& config, uint32_t seed) : config(config), rng(seed) {}
+
+	// false if the datagram is dropped; otherwise release is when it leaves
+	bool schedule(size_t bytes, Clock::time_point arrival, bool stream, Clock::time_point& release) {
+		packets++;
+		byteCount += bytes;
+
+		// serialization: the link carries one packet at a time at the capped rate
+		Clock::time_point departure = arrival;
+		if (config.bandwidth > 0.0) {
+			linkFree = std::max(linkFree, arrival) + ms(bytes * 1000.0 / config.bandwidth);
+			departure = linkFree;
+		}
+		double delay = config.latencyMs + config.jitterMs * uniform(rng);
+		if (config.loss > 0.0 && uniform(rng) < config.loss) {
+			lost++;
+			if (!stream)
+				return false;
+			delay += config.retransmitMs;
+		}
+		if (!stream && config.reorder > 0.0 && uniform(rng) < config.reorder) {
+			reordered++;
+			delay += config.reorderMs;
+		}
+		release = departure + ms(delay);
+		if (stream)
+			release = std::max(release, lastRelease);
+		lastRelease = release;
+		return true;
+	}
+
+	// safe to call from another thread
+	ImpairmentStats counters() const {
+		ImpairmentStats s;
+		s.packets = packets.load(std::memory_order_relaxed);
+		s.bytes = byteCount.load(std::memory_order_relaxed);
+		s.lost = lost.load(std::memory_order_relaxed);
+		s.reordered = reordered.load(std::memory_order_relaxed);
+		return s;
+	}
+
+private:
+	static Clock::duration ms(double v) {
+		return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(v));
+	}
+
+	ImpairmentConfig config;
+	std::mt19937 rng;
+	std::uniform_real_distribution<double> uniform{ 0.0, 1.0 };
+	Clock::time_point linkFree;
+	Clock::time_point lastRelease;
+	std::atomic<uint64_t> packets{ 0 };
+	std::atomic<uint64_t> byteCount{ 0 };
+	std::atomic<uint64_t> lost{ 0 };
+	std::atomic<uint64_t> reordered{ 0 };
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "TcpProxy.h"
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+static const intptr_t NO_SOCKET = (intptr_t)INVALID_SOCKET;
+#define SHUT_WR SD_SEND
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+static const intptr_t NO_SOCKET = -1;
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+	const int POLL_INTERVAL = 50; // ms; how quickly the pumps notice stop()
+	const size_t CHUNK = 64 * 1024;
+
+	struct SocketInit {
+		SocketInit() {
+#ifdef _WIN32
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+		}
+		~SocketInit() {
+#ifdef _WIN32
+			WSACleanup();
+#endif
+		}
+	};
+
+	void initSockets() {
+		static SocketInit init;
+	}
+
+	void closeHandle(intptr_t h) {
+		if (h == NO_SOCKET)
+			return;
+#ifdef _WIN32
+		closesocket((SOCKET)h);
+#else
+		::close((int)h);
+#endif
+	}
+
+	// true when h is readable within timeoutMs
+	bool waitReadable(intptr_t h, int timeoutMs) {
+#ifdef _WIN32
+		WSAPOLLFD pfd = { (SOCKET)h, POLLRDNORM, 0 };
+		return WSAPoll(&pfd, 1, timeoutMs) > 0;
+#else
+		pollfd pfd = { (int)h, POLLIN, 0 };
+		return poll(&pfd, 1, timeoutMs) > 0;
+#endif
+	}
+
+	// rpc messages are small; the proxy must not add a Nagle delay of its own
+	void noDelay(intptr_t h) {
+		int on = 1;
+		setsockopt(h, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+	}
+
+	bool sendAll(intptr_t h, const char* data, size_t size) {
+		while (size > 0) {
+			int n = (int)send(h, data, (int)size, 0);
+			if (n <= 0)
+				return false;
+			data += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	intptr_t connectTo(const std::string& host, uint16_t port) {
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* result = nullptr;
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result)
+			return NO_SOCKET;
+		intptr_t h = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (h != NO_SOCKET && connect(h, result->ai_addr, (int)result->ai_addrlen) != 0) {
+			closeHandle(h);
+			h = NO_SOCKET;
+		}
+		freeaddrinfo(result);
+		return h;
+	}
+
+	void add(ImpairmentStats& total, const ImpairmentStats& s) {
+		total.packets += s.packets;
+		total.bytes += s.bytes;
+		total.lost += s.lost;
+		total.reordered += s.reordered;
+	}
+}
+
+TcpProxy::TcpProxy(uint16_t listenPort, const std::string& host, uint16_t port,
+	const ImpairmentConfig& up, const ImpairmentConfig& down, uint32_t seed)
+	: listenPort(listenPort), host(host), port(port), upConfig(up), downConfig(down), seed(seed), listener(NO_SOCKET) {
+	initSockets();
+}
+
+TcpProxy::~TcpProxy() {
+	stop();
+}
+
+bool TcpProxy::start() {
+	intptr_t h = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (h == NO_SOCKET)
+		return false;
+	int on = 1;
+	setsockopt(h, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(listenPort);
+	if (bind(h, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(h, SOMAXCONN) != 0) {
+		closeHandle(h);
+		return false;
+	}
+	listener = h;
+	running = true;
+	acceptor = std::thread(&TcpProxy::acceptLoop, this);
+	return true;
+}
+
+void TcpProxy::stop() {
+	if (!running.exchange(false))
+		return;
+	acceptor.join();
+	closeHandle(listener);
+	listener = NO_SOCKET;
+	reap(true);
+}
+
+void TcpProxy::stats(ImpairmentStats& up, ImpairmentStats& down, uint64_t& count) const {
+	std::lock_guard<std::mutex> guard(lock);
+	up = upClosed;
+	down = downClosed;
+	for (const Connection& c : connections) {
+		add(up, c.up->counters());
+		add(down, c.down->counters());
+	}
+	count = accepted;
+}
+
+void TcpProxy::acceptLoop() {
+	while (running) {
+		reap(false);
+		if (!waitReadable(listener, POLL_INTERVAL))
+			continue;
+		intptr_t client = (intptr_t)accept(listener, nullptr, nullptr);
+		if (client == NO_SOCKET)
+			continue;
+		intptr_t server = connectTo(host, port);
+		if (server == NO_SOCKET) {
+			std::cerr << "cannot reach " << host << ":" << port << std::endl;
+			closeHandle(client);
+			continue;
+		}
+		noDelay(client);
+		noDelay(server);
+
+		std::lock_guard<std::mutex> guard(lock);
+		// every connection impairs differently, but the same way on every run
+		uint32_t connectionSeed = seed + (uint32_t)accepted * 2;
+		accepted++;
+		connections.emplace_back();
+		Connection& c = connections.back();
+		c.client = client;
+		c.server = server;
+		c.up.reset(new Impairment(upConfig, connectionSeed));
+		c.down.reset(new Impairment(downConfig, connectionSeed + 1));
+		c.upPump = std::thread(&TcpProxy::pump, this, client, server, std::ref(*c.up), std::ref(c.finished));
+		c.downPump = std::thread(&TcpProxy::pump, this, server, client, std::ref(*c.down), std::ref(c.finished));
+	}
+}
+
+void TcpProxy::reap(bool all) {
+	std::lock_guard<std::mutex> guard(lock);
+	for (auto it = connections.begin(); it != connections.end();) {
+		if (!all && it->finished.load() < 2) {
+			++it;
+			continue;
+		}
+		it->upPump.join();
+		it->downPump.join();
+		closeHandle(it->client);
+		closeHandle(it->server);
+		add(upClosed, it->up->counters());
+		add(downClosed, it->down->counters());
+		it = connections.erase(it);
+	}
+}
+
+// Reads whatever arrives on from, holds each chunk until the impairment lets
+// it go and writes it to to. A close is passed on once everything before it is out.
+void TcpProxy::pump(intptr_t from, intptr_t to, Impairment& impairment, std::atomic<int>& finished) {
+	struct Chunk {
+		Clock::time_point release;
+		std::vector<char> data;
+	};
+	std::deque<Chunk> queue;
+	std::vector<char> buf(CHUNK);
+	bool open = true;
+
+	while (running && (open || !queue.empty())) {
+		int timeout = POLL_INTERVAL;
+		if (!queue.empty()) {
+			auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(queue.front().release - Clock::now()).count();
+			timeout = (int)std::max<long long>(0, std::min<long long>(wait, POLL_INTERVAL));
+		}
+		if (open && waitReadable(from, timeout)) {
+			int n = (int)recv(from, buf.data(), (int)buf.size(), 0);
+			if (n <= 0) {
+				open = false;
+			}
+			else {
+				Chunk chunk;
+				impairment.schedule(n, Clock::now(), true, chunk.release);
+				chunk.data.assign(buf.begin(), buf.begin() + n);
+				queue.push_back(std::move(chunk));
+			}
+		}
+		else if (!open) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+		}
+
+		// releases of a stream never go backwards, so the front is always due first
+		for (auto now = Clock::now(); !queue.empty() && queue.front().release <= now; queue.pop_front()) {
+			if (!sendAll(to, queue.front().data.data(), queue.front().data.size())) {
+				open = false;
+				queue.clear();
+				break;
+			}
+		}
+	}
+	// the peer answers the half close by closing too, which ends the other pump
+	shutdown(to, SHUT_WR);
+	finished++;
+}
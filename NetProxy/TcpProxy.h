@@ -0,0 +1,63 @@
+#ifndef TCPPROXY_H
+#define TCPPROXY_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Impairment.h"
+
+// Forwards every connection on listenPort to host:port, impairing each
+// direction on its own. Every connection gets two pump threads, which is fine
+// for a test tool with a few thousand sessions at most.
+class TcpProxy {
+public:
+	TcpProxy(uint16_t listenPort, const std::string& host, uint16_t port,
+		const ImpairmentConfig& up, const ImpairmentConfig& down, uint32_t seed);
+	~TcpProxy();
+
+	bool start();
+	void stop();
+
+	// summed over every connection so far; up is client to server
+	void stats(ImpairmentStats& up, ImpairmentStats& down, uint64_t& connections) const;
+
+private:
+	struct Connection {
+		intptr_t client;
+		intptr_t server;
+		std::unique_ptr<Impairment> up;
+		std::unique_ptr<Impairment> down;
+		std::thread upPump;
+		std::thread downPump;
+		std::atomic<int> finished{ 0 }; // pumps done; both closes the connection
+	};
+
+	void acceptLoop();
+	void pump(intptr_t from, intptr_t to, Impairment& impairment, std::atomic<int>& finished);
+	// joins and closes connections whose pumps are both done
+	void reap(bool all);
+
+	uint16_t listenPort;
+	std::string host;
+	uint16_t port;
+	ImpairmentConfig upConfig;
+	ImpairmentConfig downConfig;
+	uint32_t seed;
+
+	intptr_t listener;
+	std::atomic<bool> running{ false };
+	std::thread acceptor;
+	mutable std::mutex lock;
+	std::list<Connection> connections;
+	// counters of the connections already reaped
+	ImpairmentStats upClosed = {};
+	ImpairmentStats downClosed = {};
+	uint64_t accepted = 0;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "UdpProxy.h"
+
+#include <iostream>
+
+namespace
+{
+	const int POLL_INTERVAL = 50; // ms; how quickly the threads notice stop()
+	const size_t MAX_DATAGRAM = 65536;
+
+	uint64_t key(const UdpAddress& a) {
+		return (uint64_t)a.ip << 16 | a.port;
+	}
+}
+
+UdpProxy::UdpProxy(uint16_t listenPort, const UdpAddress& server,
+	const ImpairmentConfig& upConfig, const ImpairmentConfig& downConfig, uint32_t seed)
+	: listenPort(listenPort), server(server), up(upConfig, seed), down(downConfig, seed + 1) {
+}
+
+UdpProxy::~UdpProxy() {
+	stop();
+}
+
+bool UdpProxy::start() {
+	if (!listener.open(listenPort))
+		return false;
+	running = true;
+	listenThread = std::thread(&UdpProxy::listenLoop, this);
+	sendThread = std::thread(&UdpProxy::sendLoop, this);
+	return true;
+}
+
+void UdpProxy::stop() {
+	if (!running.exchange(false))
+		return;
+	queueReady.notify_all();
+	listenThread.join();
+	sendThread.join();
+	for (auto& p : peers)
+		p.second->receiver.join();
+	peers.clear();
+	listener.close();
+}
+
+void UdpProxy::stats(ImpairmentStats& upStats, ImpairmentStats& downStats, uint64_t& clients) const {
+	upStats = up.counters();
+	downStats = down.counters();
+	clients = peerCount.load();
+}
+
+// client -> server
+void UdpProxy::listenLoop() {
+	std::vector<unsigned char> buf(MAX_DATAGRAM);
+	while (running) {
+		UdpAddress from;
+		int n = listener.receiveFrom(from, buf.data(), buf.size(), POLL_INTERVAL);
+		if (n <= 0)
+			continue;
+		std::unique_ptr<Peer>& peer = peers[key(from)];
+		if (!peer) {
+			peer.reset(new Peer());
+			peer->client = from;
+			if (!peer->upstream.open()) {
+				std::cerr << "no upstream socket for a new client" << std::endl;
+				peers.erase(key(from));
+				continue;
+			}
+			peer->receiver = std::thread(&UdpProxy::peerLoop, this, peer.get());
+			peerCount++;
+		}
+		delay(up, &peer->upstream, server, buf.data(), n);
+	}
+}
+
+// server -> one client
+void UdpProxy::peerLoop(Peer* peer) {
+	std::vector<unsigned char> buf(MAX_DATAGRAM);
+	while (running) {
+		UdpAddress from;
+		int n = peer->upstream.receiveFrom(from, buf.data(), buf.size(), POLL_INTERVAL);
+		if (n <= 0 || !(from == server))
+			continue;
+		std::lock_guard<std::mutex> guard(downLock);
+		delay(down, &listener, peer->client, buf.data(), n);
+	}
+}
+
+void UdpProxy::delay(Impairment& impairment, UdpSocket* socket, const UdpAddress& to, const unsigned char* data, size_t size) {
+	Pending p;
+	if (!impairment.schedule(size, Clock::now(), false, p.release))
+		return;
+	p.socket = socket;
+	p.to = to;
+	p.data.assign(data, data + size);
+	std::lock_guard<std::mutex> guard(queueLock);
+	p.order = queued++;
+	queue.push(std::move(p));
+	queueReady.notify_one();
+}
+
+// sends every datagram when its release time comes
+void UdpProxy::sendLoop() {
+	std::unique_lock<std::mutex> guard(queueLock);
+	while (running) {
+		if (queue.empty()) {
+			queueReady.wait_for(guard, std::chrono::milliseconds(POLL_INTERVAL));
+			continue;
+		}
+		// a copy: the top can change while the lock is released
+		Clock::time_point release = queue.top().release;
+		if (release > Clock::now()) {
+			queueReady.wait_until(guard, release);
+			continue;
+		}
+		Pending p = queue.top();
+		queue.pop();
+		guard.unlock();
+		p.socket->sendTo(p.to, p.data.data(), p.data.size());
+		guard.lock();
+	}
+}
@@ -0,0 +1,82 @@
+#ifndef UDPPROXY_H
+#define UDPPROXY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Impairment.h"
+#include "UdpSocket.h"
+
+// Forwards datagrams between clients and one server address, impairing each
+// direction. Every client gets its own upstream socket so the server sees a
+// distinct source address per client and its replies can be routed back.
+// Datagrams wait in a delay line ordered by release time, so jitter and the
+// reorder option let later datagrams overtake earlier ones.
+class UdpProxy {
+public:
+	UdpProxy(uint16_t listenPort, const UdpAddress& server,
+		const ImpairmentConfig& up, const ImpairmentConfig& down, uint32_t seed);
+	~UdpProxy();
+
+	bool start();
+	void stop();
+
+	// up is client to server
+	void stats(ImpairmentStats& up, ImpairmentStats& down, uint64_t& clients) const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Peer {
+		UdpAddress client;
+		UdpSocket upstream;
+		std::thread receiver;
+	};
+	struct Pending {
+		Clock::time_point release;
+		uint64_t order; // keeps datagrams with the same release in arrival order
+		UdpSocket* socket;
+		UdpAddress to;
+		std::vector<unsigned char> data;
+
+		bool operator<(const Pending& o) const {
+			return release != o.release ? release > o.release : order > o.order;
+		}
+	};
+
+	void listenLoop();
+	void peerLoop(Peer* peer);
+	void sendLoop();
+	void delay(Impairment& impairment, UdpSocket* socket, const UdpAddress& to, const unsigned char* data, size_t size);
+
+	uint16_t listenPort;
+	UdpAddress server;
+	Impairment up;
+	Impairment down;
+
+	UdpSocket listener;
+	std::atomic<bool> running{ false };
+	std::thread listenThread;
+	std::thread sendThread;
+
+	// owned by the listen thread; receivers only read their own entry
+	std::map<uint64_t, std::unique_ptr<Peer>> peers;
+	std::atomic<uint64_t> peerCount{ 0 };
+	// down is fed by every peer thread
+	std::mutex downLock;
+
+	std::mutex queueLock;
+	std::condition_variable queueReady;
+	std::priority_queue<Pending> queue;
+	uint64_t queued = 0;
+};
+
+#endif
@@ -0,0 +1,121 @@
+// NetProxy: puts an internet-like link between a client (or Bot) and the server.
+//
+// Proxies the rpc port over tcp and the pose channel over udp, adding latency,
+// jitter, loss, reordering and a bandwidth cap to both directions. Runs are
+// seeded, so the same traffic is impaired the same way every time.
+// The client has to be pointed at the proxy's ports, since the server
+// advertises its own udp port:
+//   Server
+//   NetProxy --latency 40 --jitter 10 --loss 0.02
+//   Minimal --server 127.0.0.1 --port 9050 --udp-port 9051
+//   Bot --port 9050
+// On Linux it needs nothing but the standard library:
+//   g++ -std=c++14 -O2 -IShared -INetProxy NetProxy/*.cpp Shared/UdpSocket.cpp -pthread -o netproxy
+//
+//   netproxy [--server host] [--port 8050] [--listen 9050]
+//            [--udp-port 8051] [--udp-listen 9051]
+//            [--latency ms] [--jitter ms] [--loss fraction] [--reorder fraction]
+//            [--reorder-ms ms] [--bandwidth kbit/s] [--retransmit-ms ms] [--seed n]
+// Delays are per direction, so --latency 40 makes a round trip 80 ms longer.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Impairment.h"
+#include "TcpProxy.h"
+#include "UdpProxy.h"
+#include "UdpSocket.h"
+
+#define PORT 8050
+#define UDP_PORT 8051
+#define LISTEN_PORT 9050
+#define UDP_LISTEN_PORT 9051
+#define STATS_INTERVAL std::chrono::seconds(5)
+
+void PrintStats(const char* name, const ImpairmentStats& s) {
+	std::cout << "  " << name << ": " << s.packets << " packets, " << s.bytes / 1024 << " KiB, "
+		<< s.lost << " lost, " << s.reordered << " reordered" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	std::string host = "127.0.0.1";
+	int port = PORT;
+	int listenPort = LISTEN_PORT;
+	int udpPort = UDP_PORT;
+	int udpListenPort = UDP_LISTEN_PORT;
+	uint32_t seed = 1;
+	ImpairmentConfig link;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--server") && i + 1 < argc)
+			host = argv[++i];
+		else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+			port = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--listen") && i + 1 < argc)
+			listenPort = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--udp-port") && i + 1 < argc)
+			udpPort = atoi(argv[++i]); // 0 proxies the rpc port only
+		else if (!strcmp(argv[i], "--udp-listen") && i + 1 < argc)
+			udpListenPort = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--latency") && i + 1 < argc)
+			link.latencyMs = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--jitter") && i + 1 < argc)
+			link.jitterMs = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--loss") && i + 1 < argc)
+			link.loss = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--reorder") && i + 1 < argc)
+			link.reorder = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--reorder-ms") && i + 1 < argc)
+			link.reorderMs = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--bandwidth") && i + 1 < argc)
+			link.bandwidth = atof(argv[++i]) * 1000.0 / 8.0;
+		else if (!strcmp(argv[i], "--retransmit-ms") && i + 1 < argc)
+			link.retransmitMs = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = (uint32_t)atoi(argv[++i]);
+	}
+
+	TcpProxy tcp((uint16_t)listenPort, host, (uint16_t)port, link, link, seed);
+	if (!tcp.start()) {
+		std::cerr << "cannot listen on tcp port " << listenPort << std::endl;
+		return 1;
+	}
+	std::cout << "rpc: " << listenPort << " -> " << host << ":" << port << std::endl;
+
+	UdpAddress server;
+	std::unique_ptr<UdpProxy> udp;
+	if (udpPort && UdpSocket::resolve(host.c_str(), (uint16_t)udpPort, server)) {
+		// the tcp connections use seeds counting up from seed; keep clear of them
+		udp.reset(new UdpProxy((uint16_t)udpListenPort, server, link, link, seed + 0x10000));
+		if (udp->start())
+			std::cout << "poses: " << udpListenPort << " -> " << host << ":" << udpPort << std::endl;
+		else
+			udp.reset();
+	}
+	std::cout << "each way: " << link.latencyMs << " ms + up to " << link.jitterMs << " ms jitter, "
+		<< link.loss * 100 << "% loss, " << link.reorder * 100 << "% reordered by " << link.reorderMs << " ms, "
+		<< (link.bandwidth > 0 ? std::to_string(link.bandwidth * 8 / 1000) + " kbit/s" : std::string("no bandwidth cap"))
+		<< ", seed " << seed << std::endl;
+
+	for (;;) {
+		std::this_thread::sleep_for(STATS_INTERVAL);
+		ImpairmentStats upStats, downStats;
+		uint64_t count;
+		tcp.stats(upStats, downStats, count);
+		std::cout << "rpc, " << count << " connections" << std::endl;
+		PrintStats("up", upStats);
+		PrintStats("down", downStats);
+		if (udp) {
+			udp->stats(upStats, downStats, count);
+			std::cout << "poses, " << count << " clients" << std::endl;
+			PrintStats("up", upStats);
+			PrintStats("down", downStats);
+		}
+	}
+	return 0;
+}
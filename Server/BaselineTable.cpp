@@ -0,0 +1,36 @@
+#include "pch.h"
+
+#include "BaselineTable.h"
+
+Packet BaselineTable::encode(rpc::session_id_t session, const SyncReply& reply, uint32_t ackTick) {
+	std::shared_ptr<History> history;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto& slot = histories[session];
+		if (!slot)
+			slot = std::make_shared<History>();
+		history = slot;
+	}
+	std::lock_guard<std::mutex> guard(history->lock);
+	return PackDeltaSyncReply(reply, ackTick, history->ring);
+}
+
+void BaselineTable::forget(rpc::session_id_t session) {
+	std::lock_guard<std::mutex> guard(lock);
+	histories.erase(session);
+}
+
+void BaselineTable::prune(const std::function<bool(rpc::session_id_t)>& keep) {
+	std::lock_guard<std::mutex> guard(lock);
+	for (auto it = histories.begin(); it != histories.end();) {
+		if (keep(it->first))
+			++it;
+		else
+			it = histories.erase(it);
+	}
+}
+
+size_t BaselineTable::size() const {
+	std::lock_guard<std::mutex> guard(lock);
+	return histories.size();
+}
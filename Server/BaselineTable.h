@@ -0,0 +1,36 @@
+#ifndef BASELINETABLE_H
+#define BASELINETABLE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "rpc/config.h"
+// Shared struct
+#include "Protocol.h"
+#include "SnapshotDelta.h"
+
+// Per-session history of the opponent snapshots sent by "sync_delta", so the
+// next reply can be encoded against whichever one the client acknowledged.
+class BaselineTable {
+public:
+	// encode reply against the snapshot the session acknowledged and remember it
+	Packet encode(rpc::session_id_t session, const SyncReply& reply, uint32_t ackTick);
+	void forget(rpc::session_id_t session);
+	// drop the histories of sessions keep() rejects
+	void prune(const std::function<bool(rpc::session_id_t)>& keep);
+	size_t size() const;
+
+private:
+	struct History {
+		std::mutex lock;
+		SnapshotRing ring;
+	};
+
+	mutable std::mutex lock;
+	std::unordered_map<rpc::session_id_t, std::shared_ptr<History>> histories;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HITTEST_H
+#define HITTEST_H
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+// Shared placement and mesh
+#include "Arena.h"
+#include "MeshBvh.h"
+
+// Server-side shot geometry. A shot is judged in the shooter's own tracking
+// space, against the target placed there the way the shooter's client draws
+// it (Arena.h). A player is hit when the shot ray passes through the head
+// sphere or the torso sphere below it; given the head model, a shot through
+// the head sphere must hit the model as well.
+namespace hittest
+{
+	const float RANGE = 50.0f;
+	const float HEAD_RADIUS = 0.15f;
+	const float TORSO_RADIUS = 0.25f;
+	const float TORSO_DROP = 0.45f;    // torso centre below the head
+
+	// the target's head, from its own tracking space into the shooter's
+	inline glm::vec3 targetInView(const glm::vec3& head) {
+		return arena::OpponentToView(head);
+	}
+
+	// distance along the normalized ray to the sphere, if it is hit within range
+	inline bool raySphere(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius, float& t) {
+		glm::vec3 oc = center - origin;
+		float along = glm::dot(oc, dir);
+		float d2 = glm::dot(oc, oc) - along * along;
+		if (d2 > radius * radius)
+			return false;
+		float half = std::sqrt(radius * radius - d2);
+		t = along - half >= 0.0f ? along - half : along + half;
+		return t >= 0.0f && t <= RANGE;
+	}
+
+	// the normalized ray against a mesh placed by model, within range
+	inline bool rayMesh(const glm::vec3& origin, const glm::vec3& dir, const glm::mat4& model, const MeshBvh& mesh) {
+		glm::mat4 toModel = glm::inverse(model);
+		// an affine map keeps the ray's parameter, so t stays in metres
+		glm::vec3 o(toModel * glm::vec4(origin, 1.0f));
+		glm::vec3 d(toModel * glm::vec4(dir, 0.0f));
+		MeshHit hit;
+		return mesh.raycast(o, d, RANGE, hit);
+	}
+
+	// Shot and target head both in the shooter's space. With a mesh, a head
+	// sphere hit is checked against it as placed by headModel (Arena.h); the
+	// torso has no mesh and stays a sphere.
+	inline bool shotHits(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& head,
+		const MeshBvh* mesh = nullptr, const glm::mat4& headModel = glm::mat4(1.0f)) {
+		float len = std::sqrt(glm::dot(direction, direction));
+		if (len < 1e-6f)
+			return false;
+		glm::vec3 dir = direction / len;
+		float t;
+		if (raySphere(origin, dir, head, HEAD_RADIUS, t) && (!mesh || rayMesh(origin, dir, headModel, *mesh)))
+			return true;
+		return raySphere(origin, dir, head - glm::vec3(0.0f, TORSO_DROP, 0.0f), TORSO_RADIUS, t);
+	}
+}
+
+#endif
@@ -0,0 +1,178 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "HitTest.h"
+#include "Match.h"
+
+static int64_t Now() {
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+Match::Match() {
+	reset();
+}
+
+void Match::reset() {
+	replay.end();
+	for (int i = 0; i < 2; i++) {
+		pending[i].publish(PlayerInput());
+		pendingFire[i] = false;
+		shotPending[i] = false;
+		seated[i] = false;
+		state[i] = Player();
+		history[i].clear();
+		killed[i] = false;
+		shots[i] = 0;
+		hits[i] = 0;
+		firedAt[i] = 0;
+		diedAt[i] = 0;
+		inputSeq[i] = 0;
+		lastInput[i] = Now();
+	}
+	ticks = 0;
+	time = 0.0;
+	startAt = 0.0;
+	published.publish(MatchSnapshot());
+}
+
+void Match::newRound() {
+	for (int i = 0; i < 2; i++) {
+		history[i].clear();
+		killed[i] = false;
+		shots[i] = 0;
+		hits[i] = 0;
+		firedAt[i] = 0;
+		diedAt[i] = 0;
+	}
+	startAt = 0.0;
+}
+
+void Match::submit(int slot, const Player& p, uint32_t inputSeq) {
+	PlayerInput input = { p, inputSeq };
+	pending[slot].publish(input);
+	lastInput[slot].store(Now(), std::memory_order_relaxed);
+}
+
+void Match::fire(int slot) {
+	pendingFire[slot].store(true, std::memory_order_relaxed);
+	lastInput[slot].store(Now(), std::memory_order_relaxed);
+}
+
+void Match::shoot(int slot, const Shot& shot) {
+	pendingShot[slot].publish(shot);
+	shotPending[slot].store(true, std::memory_order_release);
+	lastInput[slot].store(Now(), std::memory_order_relaxed);
+}
+
+double Match::idleSeconds(int slot) const {
+	auto idle = std::chrono::steady_clock::duration(Now() - lastInput[slot].load(std::memory_order_relaxed));
+	return std::chrono::duration<double>(idle).count();
+}
+
+void Match::setSeated(int slot, bool seated) {
+	if (seated)
+		lastInput[slot].store(Now(), std::memory_order_relaxed);
+	this->seated[slot].store(seated, std::memory_order_relaxed);
+}
+
+MatchSnapshot Match::snapshot() const {
+	return published.read();
+}
+
+double Match::clock() const {
+	MatchSnapshot snap = published.read();
+	auto since = std::chrono::steady_clock::duration(Now() - snap.tickedAt);
+	return snap.time + std::chrono::duration<double>(since).count();
+}
+
+void Match::tick(double dt) {
+	ticks++;
+	time += dt;
+	if (startAt == 0.0 && isSeated(0) && isSeated(1))
+		startAt = time + START_DELAY;
+
+	bool shot[2] = { false, false };
+	for (int i = 0; i < 2; i++) {
+		Player prev = state[i];
+		PlayerInput input = pending[i].read();
+		state[i] = input.player;
+		inputSeq[i] = input.seq;
+		// a "fire" rpc sticks until the next tick even if an "in" overwrote the flag
+		if (pendingFire[i].exchange(false, std::memory_order_relaxed))
+			state[i].fire = true;
+		shot[i] = shotPending[i].exchange(false, std::memory_order_acquire);
+		if (shot[i])
+			state[i].fire = true;
+		// only the server decides who is dead; same rule the client predicts with
+		LocalState self = { false, killed[i] };
+		ApplyInput(self, state[i]);
+		state[i].fire = self.fire;
+		state[i].dead = self.dead;
+
+		if (state[i].fire && !prev.fire)
+			firedAt[i] = ticks;
+		history[i].record(ticks, time, state[i]);
+	}
+	// both histories include this tick before either shot is checked
+	for (int i = 0; i < 2; i++) {
+		if (shot[i])
+			resolveShot(i, pendingShot[i].read());
+	}
+
+	MatchSnapshot snap;
+	snap.tick = ticks;
+	snap.time = time;
+	snap.startAt = startAt;
+	snap.tickedAt = Now();
+	for (int i = 0; i < 2; i++) {
+		snap.players[i] = state[i];
+		snap.firedAt[i] = firedAt[i];
+		snap.diedAt[i] = diedAt[i];
+		snap.shots[i] = shots[i];
+		snap.hits[i] = hits[i];
+		snap.inputSeq[i] = inputSeq[i];
+	}
+	published.publish(snap);
+
+	if (replay.active()) {
+		ReplayTick t;
+		t.tick = ticks;
+		t.time = time;
+		for (int i = 0; i < 2; i++) {
+			t.players[i] = state[i];
+			t.inputSeq[i] = inputSeq[i];
+			t.fired[i] = firedAt[i] == ticks;
+			t.died[i] = diedAt[i] == ticks;
+		}
+		replay.append(t, startAt);
+	}
+}
+
+// Lag compensation: the target is put back where the shooter saw it, at most
+// MAX_REWIND ago, and the shot ray is tested against it there.
+void Match::resolveShot(int shooter, const Shot& shot) {
+	int target = otherSlot(shooter);
+	if (killed[shooter] || killed[target])
+		return;
+	// false starts, and trigger times the shooter's clock cannot have seen yet
+	if (startAt == 0.0 || shot.firedAt < startAt || shot.firedAt > time + MAX_CLOCK_ERROR)
+		return;
+	shots[shooter]++;
+
+	PoseHistory::Pose pose;
+	double seen = std::min(shot.viewTime, shot.firedAt);
+	double when = std::min(time, std::max(seen, time - MAX_REWIND));
+	if (!history[target].at(when, pose))
+		return;
+	glm::vec3 head = hittest::targetInView(pose.headPos);
+	if (!hittest::shotHits(shot.origin, shot.direction, head, headMesh, arena::OpponentHead(pose.headPos, pose.headrotation)))
+		return;
+
+	hits[shooter]++;
+	killed[target] = true;
+	state[target].dead = true;
+	state[target].fire = false;
+	diedAt[target] = ticks;
+}
@@ -0,0 +1,114 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <atomic>
+#include <cstdint>
+
+// Shared struct
+#include "Player.h"
+#include "MeshBvh.h"
+#include "PoseHistory.h"
+#include "Prediction.h"
+#include "Protocol.h"
+#include "ReplayRecorder.h"
+#include "SnapshotBuffer.h"
+
+// What the rpc handlers get to see: a copy of the match taken at the end of a tick.
+struct MatchSnapshot {
+	uint64_t tick = 0; // ticks since the match started, first tick is 1
+	double time = 0.0; // seconds of simulated match time
+	Player players[2];
+	// tick of each player's latest shot and death, 0 if it has not happened
+	uint64_t firedAt[2] = { 0, 0 };
+	uint64_t diedAt[2] = { 0, 0 };
+	// shots checked and shots that hit, per shooter
+	uint32_t shots[2] = { 0, 0 };
+	uint32_t hits[2] = { 0, 0 };
+	// last input of each client's that went into this tick (Prediction.h)
+	uint32_t inputSeq[2] = { 0, 0 };
+	// match time of the start signal, 0 until both seats are taken
+	double startAt = 0.0;
+	int64_t tickedAt = 0; // steady clock ticks when this snapshot was taken
+};
+
+// A client's player as sent, with the number the client gave that frame
+struct PlayerInput {
+	Player player;
+	uint32_t seq; // 0 for clients that do not number their input
+};
+
+// Authoritative state of one duel. The rpc handlers only queue input; the tick
+// thread is the sole writer of the match state. Neither side ever takes a lock.
+class Match {
+public:
+	// furthest back a shot may rewind its target, in seconds
+	static constexpr double MAX_REWIND = 0.25;
+	// seconds from both seats being taken to the start signal
+	static constexpr double START_DELAY = 10.0;
+	// how far a shot's trigger time may lie ahead of the match clock
+	static constexpr double MAX_CLOCK_ERROR = 0.05;
+
+	Match();
+
+	static int otherSlot(int slot) { return 1 - slot; }
+
+	// rpc side
+	void submit(int slot, const Player& p, uint32_t inputSeq = 0);
+	void fire(int slot);
+	// a shot to be checked against the opponent as the shooter saw it
+	void shoot(int slot, const Shot& shot);
+	MatchSnapshot snapshot() const;
+	// match time right now, carried on from the last tick
+	double clock() const;
+	// seconds since the client in the slot last sent input, or took the seat
+	double idleSeconds(int slot) const;
+	// set by the registry as sessions take and leave their seats
+	void setSeated(int slot, bool seated);
+	bool isSeated(int slot) const { return seated[slot].load(std::memory_order_relaxed); }
+
+	// tick side
+	void tick(double dt);
+	// back to a fresh duel so the slab entry can be reused; ends the recording
+	void reset();
+	// start the duel over for a newly seated opponent: scores, deaths and the
+	// start signal go, the clock, ticks and recording carry on
+	void newRound();
+	// record every tick from now on under the given match id
+	void record(ReplayRecorder* recorder, uint32_t id) { replay.begin(recorder, id); }
+	// the head model to check head shots against (HitTest.h), nullptr for the
+	// sphere alone; set before the match is seated, kept across reset()
+	void setHeadMesh(const MeshBvh* mesh) { headMesh = mesh; }
+
+	SnapshotBuffer<PlayerInput>::Counters inputCounters(int slot) const { return pending[slot].counters(); }
+	SnapshotBuffer<MatchSnapshot>::Counters snapshotCounters() const { return published.counters(); }
+
+private:
+	// latest input from each client
+	SnapshotBuffer<PlayerInput> pending[2];
+	std::atomic<bool> pendingFire[2];
+	SnapshotBuffer<Shot> pendingShot[2];
+	std::atomic<bool> shotPending[2];
+	std::atomic<bool> seated[2];
+	std::atomic<int64_t> lastInput[2]; // steady clock ticks
+
+	void resolveShot(int shooter, const Shot& shot);
+
+	// owned by the tick thread
+	Player state[2];
+	PoseHistory history[2];
+	bool killed[2];
+	uint32_t shots[2];
+	uint32_t hits[2];
+	uint64_t ticks;
+	double time;
+	uint64_t firedAt[2];
+	uint64_t diedAt[2];
+	uint32_t inputSeq[2];
+	double startAt;
+	ReplayTrack replay;
+	const MeshBvh* headMesh = nullptr;
+
+	SnapshotBuffer<MatchSnapshot> published;
+};
+
+#endif
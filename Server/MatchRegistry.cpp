@@ -0,0 +1,167 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "MatchRegistry.h"
+
+MatchRegistry::MatchRegistry(size_t capacity, ShardPool& shards) :
+	cap(std::max<size_t>(capacity, 1)),
+	slab(new Match[std::max<size_t>(capacity, 1)]),
+	shards(shards),
+	occupants(cap),
+	inUse(cap, false) {
+	// hand out low ids first
+	for (size_t i = cap; i > 0; i--)
+		freeList.push_back((uint32_t)(i - 1));
+}
+
+bool MatchRegistry::seat(rpc::session_id_t session, Seat& out) {
+	{
+		std::shared_lock<std::shared_mutex> read(lock);
+		auto it = seats.find(session);
+		if (it != seats.end()) {
+			out = it->second;
+			return true;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> write(lock);
+	auto it = seats.find(session);
+	if (it != seats.end()) {
+		out = it->second;
+		return true;
+	}
+
+	Seat s;
+	if (!waiting.empty()) {
+		s.match = waiting.back();
+		waiting.pop_back();
+		s.slot = occupants[s.match].empty() ? 0 : Match::otherSlot(seats[occupants[s.match][0]].slot);
+		// the one still seated may have played someone else in this match already
+		Match* m = &slab[s.match];
+		shards.post(s.match, [m]() { m->newRound(); });
+	}
+	else {
+		if (!allocate(s.match))
+			return false;
+		s.slot = 0;
+		waiting.push_back(s.match);
+	}
+	s.seating = ++seatings;
+	occupants[s.match].push_back(session);
+	seats[session] = s;
+	slab[s.match].setSeated(s.slot, true);
+	out = s;
+	return true;
+}
+
+void MatchRegistry::leave(rpc::session_id_t session) {
+	std::unique_lock<std::shared_mutex> write(lock);
+	if (seats.count(session) == 0)
+		return;
+	unseat(session);
+	pairWaiting();
+}
+
+std::vector<rpc::session_id_t> MatchRegistry::reapIdle() {
+	std::unique_lock<std::shared_mutex> write(lock);
+	std::vector<rpc::session_id_t> idle;
+	for (const auto& s : seats) {
+		if (slab[s.second.match].idleSeconds(s.second.slot) >= IDLE_TIMEOUT)
+			idle.push_back(s.first);
+	}
+	for (rpc::session_id_t session : idle)
+		unseat(session);
+	pairWaiting();
+	return idle;
+}
+
+bool MatchRegistry::isSeated(rpc::session_id_t session) const {
+	std::shared_lock<std::shared_mutex> read(lock);
+	return seats.count(session) != 0;
+}
+
+size_t MatchRegistry::active() const {
+	std::shared_lock<std::shared_mutex> read(lock);
+	return std::count(inUse.begin(), inUse.end(), true);
+}
+
+size_t MatchRegistry::sessions() const {
+	std::shared_lock<std::shared_mutex> read(lock);
+	return seats.size();
+}
+
+std::vector<uint32_t> MatchRegistry::activeMatches() const {
+	std::shared_lock<std::shared_mutex> read(lock);
+	std::vector<uint32_t> ids;
+	for (uint32_t i = 0; i < cap; i++) {
+		if (inUse[i])
+			ids.push_back(i);
+	}
+	return ids;
+}
+
+// callers hold the write lock
+bool MatchRegistry::allocate(uint32_t& id) {
+	if (freeList.empty())
+		return false;
+
+	id = freeList.back();
+	freeList.pop_back();
+	inUse[id] = true;
+	Match* m = &slab[id];
+	Shard& shard = shards.shardFor(id);
+	ReplayRecorder* r = recorder;
+	shards.post(id, [m, &shard, r, id]() {
+		shard.attach(m);
+		if (r)
+			m->record(r, id);
+	});
+	return true;
+}
+
+// callers hold the write lock; the slot goes back on the free list once its shard has let go of it
+void MatchRegistry::release(uint32_t id) {
+	Match* m = &slab[id];
+	Shard& shard = shards.shardFor(id);
+	shards.post(id, [this, m, &shard, id]() {
+		shard.detach(m);
+		m->reset();
+		std::unique_lock<std::shared_mutex> write(lock);
+		inUse[id] = false;
+		freeList.push_back(id);
+	});
+}
+
+// callers hold the write lock
+void MatchRegistry::unseat(rpc::session_id_t session) {
+	auto it = seats.find(session);
+	uint32_t id = it->second.match;
+	slab[id].setSeated(it->second.slot, false);
+	seats.erase(it);
+
+	auto& who = occupants[id];
+	who.erase(std::remove(who.begin(), who.end(), session), who.end());
+	waiting.erase(std::remove(waiting.begin(), waiting.end(), id), waiting.end());
+	if (who.empty())
+		release(id);
+	else
+		waiting.push_back(id); // the opponent left: seat the next player against the one still there
+}
+
+// callers hold the write lock. Two players left alone in different matches,
+// e.g. one whose opponent dropped and that opponent back under a new session,
+// would wait for good; the one put on the list last gives up its match and is
+// seated against the other on its next call.
+void MatchRegistry::pairWaiting() {
+	while (waiting.size() > 1) {
+		uint32_t id = waiting.back();
+		waiting.pop_back();
+		for (rpc::session_id_t session : occupants[id]) {
+			slab[id].setSeated(seats[session].slot, false);
+			seats.erase(session);
+		}
+		occupants[id].clear();
+		release(id);
+	}
+}
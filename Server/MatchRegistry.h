@@ -0,0 +1,80 @@
+#ifndef MATCHREGISTRY_H
+#define MATCHREGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "rpc/config.h"
+#include "Match.h"
+#include "ReplayRecorder.h"
+#include "ShardPool.h"
+
+// Where a session plays: match id and player slot within the match, and a
+// number that changes every time the session is seated, even in the same place
+struct Seat {
+	uint32_t match;
+	int slot;
+	uint32_t seating;
+	MSGPACK_DEFINE_ARRAY(match, slot, seating)
+};
+
+// Hosts every duel of the process. Matches live in one preallocated slab and
+// are recycled through a free list; sessions are seated by their rpc session id,
+// first into a match that is waiting for an opponent, otherwise into a new one.
+class MatchRegistry {
+public:
+	static const size_t DEFAULT_CAPACITY = 512;
+	static const int IDLE_TIMEOUT = 30; // seconds without input before a seat is given up
+
+	MatchRegistry(size_t capacity, ShardPool& shards);
+
+	// record every match allocated from now on
+	void setRecorder(ReplayRecorder* r) { recorder = r; }
+	// check head shots in every match against this mesh; before anyone is seated
+	void setHeadMesh(const MeshBvh* mesh) {
+		for (size_t i = 0; i < cap; i++)
+			slab[i].setHeadMesh(mesh);
+	}
+
+	// seat of the session, seating it on first use; false if every match is taken
+	bool seat(rpc::session_id_t session, Seat& out);
+	void leave(rpc::session_id_t session);
+	bool isSeated(rpc::session_id_t session) const;
+	// Unseats every session that sent nothing for IDLE_TIMEOUT, as a client
+	// that drops never says "leave". Returns them, for the caller to forget
+	// what it keeps per session. Run regularly.
+	std::vector<rpc::session_id_t> reapIdle();
+
+	Match& match(uint32_t id) { return slab[id]; }
+	size_t capacity() const { return cap; }
+	size_t active() const;
+	size_t sessions() const;
+
+	// ids of the matches that are currently in use
+	std::vector<uint32_t> activeMatches() const;
+
+private:
+	bool allocate(uint32_t& id);
+	void release(uint32_t id);
+	void unseat(rpc::session_id_t session);
+	void pairWaiting();
+
+	size_t cap;
+	std::unique_ptr<Match[]> slab;
+	ShardPool& shards;
+	ReplayRecorder* recorder = nullptr;
+
+	mutable std::shared_mutex lock;
+	std::unordered_map<rpc::session_id_t, Seat> seats;
+	std::vector<std::vector<rpc::session_id_t>> occupants; // per match
+	std::vector<uint32_t> freeList;
+	std::vector<uint32_t> waiting; // matches with one player
+	uint32_t seatings = 0;
+	std::vector<bool> inUse;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "Metrics.h"
+
+namespace
+{
+	std::atomic<int> nextStripe{ 0 };
+
+	// each thread keeps the stripe it was given first
+	int threadStripe() {
+		thread_local int stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % LatencyHistogram::STRIPES;
+		return stripe;
+	}
+
+	int highestBit(uint64_t v) {
+		int bit = 0;
+		while (v >>= 1)
+			bit++;
+		return bit;
+	}
+
+	const char* RPC_NAMES[Metrics::RPC_COUNT] = {
+		"join", "leave", "in", "out", "sync", "sync_packed", "sync_delta",
+		"udp_token", "events", "fire", "clock", "shoot", "stats",
+		"contention", "shards", "pose_datagram"
+	};
+}
+
+LatencyHistogram::LatencyHistogram() : counts(new std::atomic<uint64_t>[STRIPES * STRIDE]) {
+	for (int i = 0; i < STRIPES * STRIDE; i++)
+		counts[i].store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketOf(uint64_t us) {
+	if (us < SUB)
+		return (int)us;
+	int shift = highestBit(us) - SUB_BITS;
+	int bucket = (shift + 1) * SUB + (int)((us >> shift) - SUB);
+	return std::min(bucket, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucketFloor(int bucket) {
+	if (bucket < SUB)
+		return bucket;
+	int shift = bucket / SUB - 1;
+	return (uint64_t)(SUB + bucket % SUB) << shift;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+	std::atomic<uint64_t>* row = &counts[threadStripe() * STRIDE];
+	row[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+	row[BUCKETS].fetch_add(us, std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::summary() const {
+	std::vector<uint64_t> total(STRIDE, 0);
+	for (int s = 0; s < STRIPES; s++)
+		for (int b = 0; b < STRIDE; b++)
+			total[b] += counts[s * STRIDE + b].load(std::memory_order_relaxed);
+
+	LatencySummary sum = {};
+	for (int b = 0; b < BUCKETS; b++)
+		sum.count += total[b];
+	if (sum.count == 0)
+		return sum;
+	sum.mean = (double)total[BUCKETS] / sum.count;
+
+	// the rank of each percentile, rounded up so p999 of 10 samples is the largest
+	const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	uint64_t* targets[] = { &sum.p50, &sum.p90, &sum.p99, &sum.p999 };
+	int next = 0;
+	uint64_t seen = 0;
+	for (int b = 0; b < BUCKETS; b++) {
+		if (!total[b])
+			continue;
+		seen += total[b];
+		uint64_t highest = b + 1 < BUCKETS ? bucketFloor(b + 1) - 1 : bucketFloor(b);
+		while (next < 4 && seen >= (uint64_t)std::ceil(quantiles[next] * sum.count))
+			*targets[next++] = highest;
+		sum.max = highest;
+	}
+	return sum;
+}
+
+const char* Metrics::name(Rpc rpc) {
+	return RPC_NAMES[rpc];
+}
+
+Metrics::Metrics() : started(std::chrono::steady_clock::now()) {
+	for (int i = 0; i < RPC_COUNT; i++) {
+		calls[i].store(0);
+		bytesIn[i].store(0);
+		bytesOut[i].store(0);
+	}
+}
+
+void Metrics::traffic(Rpc rpc, rpc::session_id_t session, size_t in, size_t out) {
+	bytesIn[rpc].fetch_add(in, std::memory_order_relaxed);
+	bytesOut[rpc].fetch_add(out, std::memory_order_relaxed);
+	TrafficStripe& stripe = stripes[threadStripe()];
+	std::lock_guard<std::mutex> guard(stripe.lock);
+	SessionTraffic& t = stripe.sessions[session];
+	t.session = (int64_t)session;
+	t.calls++;
+	t.bytesIn += in;
+	t.bytesOut += out;
+}
+
+void Metrics::forget(rpc::session_id_t session) {
+	for (TrafficStripe& stripe : stripes) {
+		std::lock_guard<std::mutex> guard(stripe.lock);
+		stripe.sessions.erase(session);
+	}
+}
+
+void Metrics::prune(const std::function<bool(rpc::session_id_t)>& keep) {
+	for (TrafficStripe& stripe : stripes) {
+		std::lock_guard<std::mutex> guard(stripe.lock);
+		for (auto it = stripe.sessions.begin(); it != stripe.sessions.end();) {
+			if (keep(it->first))
+				++it;
+			else
+				it = stripe.sessions.erase(it);
+		}
+	}
+}
+
+void Metrics::fill(ServerStats& stats, size_t topSessions) const {
+	stats.uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	stats.inFlight = inFlight.load(std::memory_order_relaxed);
+	stats.rpcs.clear();
+	for (int i = 0; i < RPC_COUNT; i++) {
+		RpcStats r;
+		r.name = RPC_NAMES[i];
+		r.calls = calls[i].load(std::memory_order_relaxed);
+		r.bytesIn = bytesIn[i].load(std::memory_order_relaxed);
+		r.bytesOut = bytesOut[i].load(std::memory_order_relaxed);
+		r.latency = latency[i].summary();
+		stats.rpcs.push_back(r);
+	}
+
+	// add up each session's stripes
+	std::unordered_map<rpc::session_id_t, SessionTraffic> merged;
+	for (TrafficStripe& stripe : stripes) {
+		std::lock_guard<std::mutex> guard(stripe.lock);
+		for (auto& s : stripe.sessions) {
+			SessionTraffic& t = merged[s.first];
+			t.session = s.second.session;
+			t.calls += s.second.calls;
+			t.bytesIn += s.second.bytesIn;
+			t.bytesOut += s.second.bytesOut;
+		}
+	}
+	stats.traffic.clear();
+	stats.traffic.reserve(merged.size());
+	for (auto& s : merged)
+		stats.traffic.push_back(s.second);
+	auto busier = [](const SessionTraffic& a, const SessionTraffic& b) {
+		return a.bytesIn + a.bytesOut > b.bytesIn + b.bytesOut;
+	};
+	size_t keep = std::min(topSessions, stats.traffic.size());
+	std::partial_sort(stats.traffic.begin(), stats.traffic.begin() + keep, stats.traffic.end(), busier);
+	stats.traffic.resize(keep);
+}
+
+namespace
+{
+	void PrintLatency(std::ostream& out, const LatencySummary& l) {
+		out << l.count << " x, mean " << std::fixed << std::setprecision(1) << l.mean << " us, p50 " << l.p50
+			<< " p90 " << l.p90 << " p99 " << l.p99 << " p999 " << l.p999 << " max " << l.max << " us";
+	}
+}
+
+void Metrics::print(std::ostream& out, const ServerStats& stats) {
+	out << "up " << (uint64_t)stats.uptime << " s, " << stats.sessions << " sessions in " << stats.matches
+		<< " matches, " << stats.inFlight << " handlers running" << std::endl;
+	for (const RpcStats& r : stats.rpcs) {
+		if (!r.calls)
+			continue;
+		out << "  " << r.name << ": ";
+		PrintLatency(out, r.latency);
+		if (r.bytesIn || r.bytesOut)
+			out << ", " << r.bytesIn << " B in, " << r.bytesOut << " B out";
+		out << std::endl;
+	}
+	for (const ShardTickStats& s : stats.shards) {
+		out << "  shard " << s.index << ": " << s.matches << " matches, " << s.dropped << " dropped, "
+			<< (int)(s.utilization * 100.0) << "% busy, tick ";
+		PrintLatency(out, s.tick);
+		out << std::endl;
+	}
+	for (const SessionTraffic& t : stats.traffic) {
+		out << "  session " << t.session << ": " << t.calls << " calls, " << t.bytesIn << " B in, "
+			<< t.bytesOut << " B out" << std::endl;
+	}
+}
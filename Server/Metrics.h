@@ -0,0 +1,121 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "rpc/config.h"
+
+// Shared struct
+#include "ServerStats.h"
+
+// HdrHistogram style latency histogram in microseconds: 16 linear sub-buckets
+// per power of two, so any value is off by at most 1/16 (6.25%), from 1 us to
+// over an hour. Recording is a single relaxed increment. Every thread counts
+// into its own stripe so threads do not fight over cache lines; readers add
+// the stripes up.
+class LatencyHistogram {
+public:
+	static const int SUB_BITS = 4;
+	static const int SUB = 1 << SUB_BITS;
+	static const int BUCKETS = (32 - SUB_BITS + 1) * SUB;
+	static const int STRIPES = 16;
+
+	LatencyHistogram();
+
+	void record(uint64_t us);
+	void record(std::chrono::steady_clock::duration d) {
+		record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+	}
+
+	// adds the stripes up; percentiles are the highest value of their bucket
+	LatencySummary summary() const;
+
+	static int bucketOf(uint64_t us);
+	// smallest value that lands in bucket
+	static uint64_t bucketFloor(int bucket);
+
+private:
+	// STRIPES rows of BUCKETS counts and the sum of the values
+	static const int STRIDE = BUCKETS + 1;
+	std::unique_ptr<std::atomic<uint64_t>[]> counts;
+};
+
+// Everything the "stats" rpc and the periodic dump report. Handlers time
+// themselves with a CallTimer; bytes are the packed payloads we see, not the
+// msgpack framing around them.
+class Metrics {
+public:
+	// the rpcs that are counted; the order is the order of the report
+	enum Rpc {
+		RPC_JOIN, RPC_LEAVE, RPC_IN, RPC_OUT, RPC_SYNC, RPC_SYNC_PACKED, RPC_SYNC_DELTA,
+		RPC_UDP_TOKEN, RPC_EVENTS, RPC_FIRE, RPC_CLOCK, RPC_SHOOT, RPC_STATS,
+		RPC_CONTENTION, RPC_SHARDS, RPC_POSE_DATAGRAM,
+		RPC_COUNT
+	};
+	static const char* name(Rpc rpc);
+
+	Metrics();
+
+	void call(Rpc rpc, std::chrono::steady_clock::duration spent) {
+		calls[rpc].fetch_add(1, std::memory_order_relaxed);
+		latency[rpc].record(spent);
+	}
+	// payload bytes of one call, for the session and the rpc
+	void traffic(Rpc rpc, rpc::session_id_t session, size_t in, size_t out);
+	void forget(rpc::session_id_t session);
+	// drop the traffic of sessions keep() rejects
+	void prune(const std::function<bool(rpc::session_id_t)>& keep);
+
+	std::atomic<int> inFlight{ 0 }; // handlers running right now
+
+	// fills uptime, rpcs, in-flight and the top sessions by bytes; the caller adds
+	// session and match counts and the shards
+	void fill(ServerStats& stats, size_t topSessions) const;
+	// human readable, for the periodic dump
+	static void print(std::ostream& out, const ServerStats& stats);
+
+private:
+	std::chrono::steady_clock::time_point started;
+	std::atomic<uint64_t> calls[RPC_COUNT];
+	std::atomic<uint64_t> bytesIn[RPC_COUNT];
+	std::atomic<uint64_t> bytesOut[RPC_COUNT];
+	LatencyHistogram latency[RPC_COUNT];
+
+	// Per-session traffic, striped by thread like LatencyHistogram: a handler
+	// only takes its own stripe's lock, which nothing but the readers and the
+	// cleanup ever want. A session shows up in every stripe it was counted in.
+	struct alignas(64) TrafficStripe {
+		std::mutex lock;
+		std::unordered_map<rpc::session_id_t, SessionTraffic> sessions;
+	};
+	mutable TrafficStripe stripes[LatencyHistogram::STRIPES];
+};
+
+// Times a handler from construction to the end of its scope
+class CallTimer {
+public:
+	CallTimer(Metrics& metrics, Metrics::Rpc rpc) : metrics(metrics), rpc(rpc), begin(std::chrono::steady_clock::now()) {
+		metrics.inFlight.fetch_add(1, std::memory_order_relaxed);
+	}
+	~CallTimer() {
+		metrics.inFlight.fetch_sub(1, std::memory_order_relaxed);
+		metrics.call(rpc, std::chrono::steady_clock::now() - begin);
+	}
+	CallTimer(const CallTimer&) = delete;
+	CallTimer& operator=(const CallTimer&) = delete;
+
+private:
+	Metrics& metrics;
+	Metrics::Rpc rpc;
+	std::chrono::steady_clock::time_point begin;
+};
+
+#endif
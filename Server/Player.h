@@ -1,3 +1,5 @@
+#pragma once
+
 #include <rpc/client.h>
 #include "glm/glm.hpp"
 #include <glm/gtx/string_cast.hpp>
@@ -0,0 +1,88 @@
+#ifndef POSEHISTORY_H
+#define POSEHISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Shared struct
+#include "Player.h"
+
+// Head and hand transforms of one player for the last SIZE ticks, so a shot can
+// be checked against where the target was when the shooter saw it. Fixed-size
+// ring filled in place by the tick thread: recording never allocates.
+class PoseHistory {
+public:
+	static const int SIZE = 64; // ~0.7 s at 90 Hz, more than MAX_REWIND
+
+	struct Pose {
+		uint64_t tick;
+		double time;
+		glm::vec3 headPos;
+		glm::quat headrotation;
+		glm::vec3 handpos;
+		glm::quat handrotation;
+	};
+
+	PoseHistory() { clear(); }
+
+	void clear() {
+		count = 0;
+		next = 0;
+	}
+
+	void record(uint64_t tick, double time, const Player& p) {
+		Pose& pose = poses[next];
+		pose.tick = tick;
+		pose.time = time;
+		pose.headPos = p.headPos;
+		pose.headrotation = p.headrotation;
+		pose.handpos = p.handpos;
+		pose.handrotation = p.handrotation;
+		next = (next + 1) % SIZE;
+		if (count < SIZE)
+			count++;
+	}
+
+	// pose at the given match time, blended between the two recorded ticks
+	// around it; times outside the history clamp to its oldest or newest entry
+	bool at(double time, Pose& out) const {
+		if (count == 0)
+			return false;
+		const Pose* newer = &entry(0);
+		if (time >= newer->time) {
+			out = *newer;
+			return true;
+		}
+		for (int i = 1; i < count; i++) {
+			const Pose* older = &entry(i);
+			if (older->time <= time) {
+				float t = (float)((time - older->time) / (newer->time - older->time));
+				out.tick = older->tick;
+				out.time = time;
+				out.headPos = glm::mix(older->headPos, newer->headPos, t);
+				out.headrotation = glm::slerp(older->headrotation, newer->headrotation, t);
+				out.handpos = glm::mix(older->handpos, newer->handpos, t);
+				out.handrotation = glm::slerp(older->handrotation, newer->handrotation, t);
+				return true;
+			}
+			newer = older;
+		}
+		out = *newer;
+		return true;
+	}
+
+	int size() const { return count; }
+
+private:
+	// 0 is the newest entry
+	const Pose& entry(int age) const { return poses[(next - 1 - age + SIZE) % SIZE]; }
+
+	Pose poses[SIZE];
+	int count;
+	int next;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "pch.h"
+
+#include <iostream>
+
+#include "PoseServer.h"
+
+PoseServer::PoseServer(uint16_t port, Handler handler) : listenPort(port), handler(handler) {
+}
+
+PoseServer::~PoseServer() {
+	stop();
+}
+
+bool PoseServer::start() {
+	if (running)
+		return true;
+	if (!socket.open(listenPort)) {
+		std::cerr << "pose channel: cannot bind udp port " << listenPort << std::endl;
+		return false;
+	}
+	running = true;
+	worker = std::thread(&PoseServer::run, this);
+	return true;
+}
+
+void PoseServer::stop() {
+	running = false;
+	if (worker.joinable())
+		worker.join();
+	socket.close();
+}
+
+uint32_t PoseServer::ticket(rpc::session_id_t session) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto it = tokens.find(session);
+	if (it != tokens.end())
+		return it->second;
+	uint32_t token;
+	do {
+		token = (uint32_t)rng();
+	} while (token == 0 || clients.count(token));
+	Client& c = clients[token];
+	c.session = session;
+	c.lastSeq = 0;
+	c.anySeq = false;
+	tokens[session] = token;
+	return token;
+}
+
+void PoseServer::forget(rpc::session_id_t session) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto it = tokens.find(session);
+	if (it == tokens.end())
+		return;
+	clients.erase(it->second);
+	tokens.erase(it);
+}
+
+PoseStats PoseServer::stats() const {
+	PoseStats s;
+	s.received = socket.received();
+	s.stale = stale.load();
+	s.rejected = rejected.load();
+	s.sent = socket.sent();
+	s.dropped = socket.dropped();
+	return s;
+}
+
+void PoseServer::run() {
+	unsigned char in[MAX_DATAGRAM_SIZE];
+	unsigned char out[MAX_DATAGRAM_SIZE];
+	while (running) {
+		UdpAddress from;
+		int n = socket.receiveFrom(from, in, sizeof(in), 100);
+		if (n <= 0)
+			continue;
+
+		PoseDatagram pose;
+		if (!UnpackPoseDatagram(in, n, pose)) {
+			rejected++;
+			continue;
+		}
+
+		rpc::session_id_t session;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			auto it = clients.find(pose.token);
+			if (it == clients.end()) {
+				rejected++;
+				continue;
+			}
+			Client& c = it->second;
+			// drop stale: a late datagram must not roll the player back
+			if (c.anySeq && (int32_t)(pose.seq - c.lastSeq) <= 0) {
+				stale++;
+				continue;
+			}
+			c.lastSeq = pose.seq;
+			c.anySeq = true;
+			session = c.session;
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		SyncReply reply;
+		if (!handler(session, pose.player, pose.inputSeq, reply))
+			continue;
+		reply.events.clear(); // events travel over rpc
+
+		size_t size;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			auto it = clients.find(pose.token);
+			if (it == clients.end())
+				continue;
+			size = PackSnapshotDatagram(pose.seq, PackDeltaSyncReply(reply, pose.ackTick, it->second.sent), out, sizeof(out));
+		}
+		if (size)
+			socket.sendTo(from, out, size);
+		if (metrics) {
+			metrics->call(Metrics::RPC_POSE_DATAGRAM, std::chrono::steady_clock::now() - begin);
+			metrics->traffic(Metrics::RPC_POSE_DATAGRAM, session, n, size);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef POSESERVER_H
+#define POSESERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#include "rpc/config.h"
+#include "Metrics.h"
+// Shared struct
+#include "PoseChannel.h"
+#include "Protocol.h"
+#include "UdpSocket.h"
+
+struct PoseStats {
+	uint64_t received;
+	uint64_t stale;     // older than a pose already applied
+	uint64_t rejected;  // malformed or unknown token
+	uint64_t sent;
+	uint64_t dropped;   // by the injected loss
+};
+
+// Server end of the UDP pose channel (PoseChannel.h). One thread receives
+// poses, hands them to the handler and answers with a delta snapshot of the
+// opponent against the tick the client acknowledged.
+class PoseServer {
+public:
+	// fills the reply for the session's pose and input seq; false if the session has no seat
+	typedef std::function<bool(rpc::session_id_t, const Player&, uint32_t, SyncReply&)> Handler;
+
+	PoseServer(uint16_t port, Handler handler);
+	~PoseServer();
+
+	bool start();
+	void stop();
+	void setLoss(double fraction) { socket.setLoss(fraction); }
+	// counts every datagram answered as a "pose_datagram" call
+	void setMetrics(Metrics* m) { metrics = m; }
+	uint16_t port() const { return socket.localPort(); }
+
+	// token the session tags its datagrams with; stays the same until forget()
+	uint32_t ticket(rpc::session_id_t session);
+	void forget(rpc::session_id_t session);
+
+	PoseStats stats() const;
+
+private:
+	struct Client {
+		rpc::session_id_t session;
+		uint32_t lastSeq;
+		bool anySeq;
+		SnapshotRing sent;
+	};
+
+	void run();
+
+	uint16_t listenPort;
+	Handler handler;
+	Metrics* metrics = nullptr;
+	UdpSocket socket;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+
+	std::mutex lock;
+	std::unordered_map<uint32_t, Client> clients; // by token
+	std::unordered_map<rpc::session_id_t, uint32_t> tokens;
+	std::mt19937 rng{ std::random_device()() };
+
+	std::atomic<uint64_t> stale{ 0 };
+	std::atomic<uint64_t> rejected{ 0 };
+};
+
+#endif
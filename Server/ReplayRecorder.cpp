@@ -0,0 +1,219 @@
+#include "pch.h"
+
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ReplayRecorder.h"
+
+ReplayRecorder::ReplayRecorder(const std::string& directory, size_t chunks) :
+	directory(directory),
+	encoded(replay::CHUNK_HEADER_SIZE + CHUNK_TICKS * REPLAY_RECORD_SIZE) {
+	for (size_t i = 0; i < chunks; i++) {
+		pool.emplace_back(new Chunk());
+		freeChunks.push_back(pool.back().get());
+	}
+}
+
+ReplayRecorder::~ReplayRecorder() {
+	stop();
+}
+
+bool ReplayRecorder::start() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (running)
+		return true;
+	running = true;
+	writer = std::thread(&ReplayRecorder::run, this);
+	return true;
+}
+
+// Writes out everything queued so far; recordings still open get their index
+void ReplayRecorder::stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!running)
+			return;
+		running = false;
+	}
+	ready.notify_all();
+	writer.join();
+	std::vector<uint32_t> open;
+	for (auto& f : files)
+		open.push_back(f.first);
+	for (uint32_t recording : open)
+		closeFile(recording);
+}
+
+uint32_t ReplayRecorder::open(uint32_t match) {
+	uint32_t recording;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		recording = nextRecording++;
+	}
+	push({ Job::OPEN, recording, match, nullptr });
+	return recording;
+}
+
+ReplayRecorder::Chunk* ReplayRecorder::acquire() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (freeChunks.empty())
+		return nullptr;
+	Chunk* chunk = freeChunks.back();
+	freeChunks.pop_back();
+	return chunk;
+}
+
+void ReplayRecorder::write(Chunk* chunk) {
+	push({ Job::WRITE, chunk->recording, 0, chunk });
+}
+
+void ReplayRecorder::release(Chunk* chunk) {
+	std::lock_guard<std::mutex> guard(lock);
+	freeChunks.push_back(chunk);
+}
+
+void ReplayRecorder::close(uint32_t recording) {
+	push({ Job::CLOSE, recording, 0, nullptr });
+}
+
+ReplayStats ReplayRecorder::stats() const {
+	ReplayStats s;
+	s.recordings = recordings.load();
+	s.chunks = chunksWritten.load();
+	s.bytes = bytes.load();
+	s.dropped = dropped.load();
+	return s;
+}
+
+void ReplayRecorder::push(const Job& job) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		jobs.push_back(job);
+	}
+	ready.notify_one();
+}
+
+void ReplayRecorder::run() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (running || !jobs.empty()) {
+		if (jobs.empty()) {
+			ready.wait(guard);
+			continue;
+		}
+		Job job = jobs.front();
+		jobs.pop_front();
+		guard.unlock();
+		switch (job.type) {
+		case Job::OPEN: openFile(job.recording, job.match); break;
+		case Job::WRITE: writeChunk(job.chunk); break;
+		case Job::CLOSE: closeFile(job.recording); break;
+		}
+		guard.lock();
+	}
+}
+
+void ReplayRecorder::openFile(uint32_t recording, uint32_t match) {
+	std::time_t now = std::time(nullptr);
+	std::tm utc;
+#ifdef _WIN32
+	gmtime_s(&utc, &now);
+#else
+	gmtime_r(&now, &utc);
+#endif
+	std::ostringstream path;
+	path << directory << "/match-" << match << "-" << std::put_time(&utc, "%Y%m%d-%H%M%S") << "-" << recording << ".wdr";
+
+	File& f = files[recording];
+	f.out.open(path.str(), std::ios::binary | std::ios::trunc);
+	if (!f.out) {
+		std::cerr << "replay: cannot create " << path.str() << std::endl;
+		files.erase(recording);
+		return;
+	}
+	unsigned char header[replay::FILE_HEADER_SIZE];
+	PackReplayHeader({ match, (uint64_t)now }, header);
+	f.out.write((const char*)header, sizeof(header));
+	f.offset = sizeof(header);
+	recordings++;
+}
+
+// Each chunk is pushed to the OS as soon as it is written, so a crash loses at
+// most the chunks still being filled
+void ReplayRecorder::writeChunk(Chunk* chunk) {
+	auto it = files.find(chunk->recording);
+	if (it != files.end()) {
+		File& f = it->second;
+		size_t size = replay::CHUNK_HEADER_SIZE + chunk->info.count * REPLAY_RECORD_SIZE;
+		PackReplayChunk(chunk->info, encoded.data());
+		for (uint32_t i = 0; i < chunk->info.count; i++)
+			PackReplayTick(chunk->ticks[i], encoded.data() + replay::CHUNK_HEADER_SIZE + i * REPLAY_RECORD_SIZE);
+		f.out.write((const char*)encoded.data(), size);
+		f.out.flush();
+		chunk->info.offset = f.offset;
+		f.index.push_back(chunk->info);
+		f.offset += size;
+		chunksWritten++;
+		bytes += size;
+	}
+	release(chunk);
+}
+
+void ReplayRecorder::closeFile(uint32_t recording) {
+	auto it = files.find(recording);
+	if (it == files.end())
+		return;
+	File& f = it->second;
+	std::vector<unsigned char> tail(f.index.size() * replay::INDEX_ENTRY_SIZE + replay::TRAILER_SIZE);
+	unsigned char* out = tail.data();
+	for (const ReplayChunk& c : f.index) {
+		codec::put32(out, c.firstTick);
+		codec::put32(out, c.count);
+		replay::put64(out, c.offset);
+	}
+	replay::put64(out, f.offset);
+	codec::put32(out, (uint32_t)f.index.size());
+	codec::put32(out, replay::INDEX_MAGIC);
+	f.out.write((const char*)tail.data(), tail.size());
+	f.out.close();
+	bytes += tail.size();
+	files.erase(it);
+}
+
+void ReplayTrack::begin(ReplayRecorder* recorder, uint32_t match) {
+	end();
+	this->recorder = recorder;
+	recording = recorder->open(match);
+}
+
+void ReplayTrack::append(const ReplayTick& tick, double startAt) {
+	if (!recorder)
+		return;
+	if (!chunk) {
+		chunk = recorder->acquire();
+		if (!chunk) {
+			recorder->drop(1);
+			return;
+		}
+		chunk->recording = recording;
+		chunk->info.firstTick = (uint32_t)tick.tick;
+		chunk->info.count = 0;
+	}
+	chunk->ticks[chunk->info.count++] = tick;
+	chunk->info.startAt = startAt;
+	if (chunk->info.count == ReplayRecorder::CHUNK_TICKS) {
+		recorder->write(chunk);
+		chunk = nullptr;
+	}
+}
+
+void ReplayTrack::end() {
+	if (!recorder)
+		return;
+	if (chunk)
+		recorder->write(chunk);
+	chunk = nullptr;
+	recorder->close(recording);
+	recorder = nullptr;
+}
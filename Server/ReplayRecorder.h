@@ -0,0 +1,114 @@
+#ifndef REPLAYRECORDER_H
+#define REPLAYRECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Shared struct
+#include "Replay.h"
+
+struct ReplayStats {
+	uint64_t recordings;
+	uint64_t chunks;
+	uint64_t bytes;
+	uint64_t dropped; // ticks lost because every chunk was in use
+};
+
+// Writes one replay file (Replay.h) per match. Tick threads copy their ticks
+// into chunks taken from a pool that is allocated up front and hand them over
+// once full; a single writer thread encodes them, appends them to the files
+// and returns them to the pool. A tick therefore costs one struct copy and,
+// every CHUNK_TICKS ticks, one short lock. If the disk falls behind the pool
+// runs dry and ticks are dropped, never waited for.
+class ReplayRecorder {
+public:
+	static const uint32_t CHUNK_TICKS = 128; // ~2 s at 60 Hz, also how much a crash can lose
+
+	struct Chunk {
+		uint32_t recording;
+		ReplayChunk info;
+		ReplayTick ticks[CHUNK_TICKS]; // encoded by the writer
+	};
+
+	// one chunk in use per recording plus the ones waiting for the disk
+	ReplayRecorder(const std::string& directory, size_t chunks);
+	~ReplayRecorder();
+
+	bool start();
+	void stop();
+
+	// any thread. Calls for one recording must come from one thread, in order.
+	uint32_t open(uint32_t match);
+	Chunk* acquire(); // nullptr when the pool is empty
+	void write(Chunk* chunk);
+	void release(Chunk* chunk); // back to the pool unwritten
+	void close(uint32_t recording);
+	void drop(uint64_t ticks) { dropped.fetch_add(ticks, std::memory_order_relaxed); }
+
+	ReplayStats stats() const;
+
+private:
+	struct Job {
+		enum Type { OPEN, WRITE, CLOSE } type;
+		uint32_t recording;
+		uint32_t match;
+		Chunk* chunk;
+	};
+	struct File {
+		std::ofstream out;
+		uint64_t offset;
+		std::vector<ReplayChunk> index;
+	};
+
+	void push(const Job& job);
+	void run();
+	void openFile(uint32_t recording, uint32_t match);
+	void writeChunk(Chunk* chunk);
+	void closeFile(uint32_t recording);
+
+	std::string directory;
+	std::vector<std::unique_ptr<Chunk>> pool;
+	std::vector<Chunk*> freeChunks;
+	uint32_t nextRecording = 1;
+
+	std::mutex lock;
+	std::condition_variable ready;
+	std::deque<Job> jobs;
+	bool running = false;
+	std::thread writer;
+
+	// writer thread only
+	std::unordered_map<uint32_t, File> files;
+	std::vector<unsigned char> encoded;
+
+	std::atomic<uint64_t> recordings{ 0 };
+	std::atomic<uint64_t> chunksWritten{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+};
+
+// The recording of one match, driven by its tick thread
+class ReplayTrack {
+public:
+	void begin(ReplayRecorder* recorder, uint32_t match);
+	void append(const ReplayTick& tick, double startAt);
+	// hands over what is left and closes the file
+	void end();
+	bool active() const { return recorder != nullptr; }
+
+private:
+	ReplayRecorder* recorder = nullptr;
+	uint32_t recording = 0;
+	ReplayRecorder::Chunk* chunk = nullptr;
+};
+
+#endif
@@ -5,71 +5,444 @@
 
 #include "rpc/server.h"
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+#include "rpc/this_handler.h"
 #include "rpc/this_session.h"
 
 // Shared struct
-#include "player.h"
+#include "Player.h"
+#include "Match.h"
+#include "BaselineTable.h"
+#include "MatchRegistry.h"
+#include "Metrics.h"
+#include "MeshBvh.h"
+#include "ObjMesh.h"
+#include "PlayerCodec.h"
+#include "PoseServer.h"
+#include "ReplayRecorder.h"
+#include "Protocol.h"
+#include "ServerStats.h"
+#include "ShardPool.h"
+#include "SnapshotDelta.h"
+#include "TickLoop.h"
 
 using std::string;
 
 #define PORT 8050
+#define UDP_PORT 8051
+#define STATS_INTERVAL std::chrono::seconds(5)
+#define SWEEP_INTERVAL std::chrono::seconds(1)
+#define TOP_SESSIONS 16
 
-void StartServer() {
-	rpc::server srv(PORT);
-	// handlers goes here 
-	//srv.bind("move", ...);
+// the client's head model, looked for here unless --head-mesh names it
+static const char* const HEAD_MESH_PATHS[] = {
+	"../Minimal/model/face/face.obj", // from the Server project directory
+	"Minimal/model/face/face.obj",    // from the solution directory
+};
 
+// What happened since lastTick, as seen from the given slot
+void AddEvents(const MatchSnapshot& snap, int slot, uint64_t lastTick, std::vector<Event>& events) {
+	int other = Match::otherSlot(slot);
+	if (snap.firedAt[other] > lastTick)
+		events.push_back({ EVENT_FIRED, snap.firedAt[other] });
+	if (snap.diedAt[other] > lastTick)
+		events.push_back({ EVENT_DIED, snap.diedAt[other] });
+	if (snap.diedAt[slot] > lastTick)
+		events.push_back({ EVENT_KILLED, snap.diedAt[slot] });
 }
 
-void UpdateLoop() {
-	bool terminated = false;
-	auto dt = std::chrono::milliseconds(30);
-	while (!terminated) {
-		// do data update
-		// sleep at the end
-		std::this_thread::sleep_for(dt);
+void PrintShardStats(const ShardPool& pool) {
+	for (const ShardStats& s : pool.stats()) {
+		std::cout << "shard " << s.index << ": " << s.matches << " matches, " << s.ticks << " ticks, "
+			<< s.dropped << " dropped, " << (int)(s.utilization() * 100.0) << "% busy" << std::endl;
 	}
 }
 
-Player first;
-Player second;
-
-int main()
+int main(int argc, char** argv)
 {
+	int tickRate = TickLoop::DEFAULT_RATE;
+	int threads = 1;
+	size_t maxMatches = MatchRegistry::DEFAULT_CAPACITY;
+	int udpPort = UDP_PORT;
+	double udpLoss = 0.0;
+	std::string metricsFile;
+	int metricsInterval = 10;
+	std::string replayDir;
+	std::string headMeshPath;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--tick-rate") && i + 1 < argc)
+			tickRate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--max-matches") && i + 1 < argc)
+			maxMatches = (size_t)std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--udp-port") && i + 1 < argc)
+			udpPort = atoi(argv[++i]); // 0 turns the pose channel off
+		else if (!strcmp(argv[i], "--udp-loss") && i + 1 < argc)
+			udpLoss = atof(argv[++i]); // fraction of snapshot datagrams to drop, for testing
+		else if (!strcmp(argv[i], "--metrics-file") && i + 1 < argc)
+			metricsFile = argv[++i]; // the "stats" report is appended here every interval
+		else if (!strcmp(argv[i], "--metrics-interval") && i + 1 < argc)
+			metricsInterval = std::max(1, atoi(argv[++i])); // seconds
+		else if (!strcmp(argv[i], "--replay-dir") && i + 1 < argc)
+			replayDir = argv[++i]; // one replay file per match goes here (Replay.h)
+		else if (!strcmp(argv[i], "--head-mesh") && i + 1 < argc)
+			headMeshPath = argv[++i]; // the client's face.obj, to check head shots against
+	}
+
+	// Each match is owned by the tick thread of its shard; handlers only queue input and read snapshots
+	// Outlives the shards: matches hand their last chunk over when they are reset
+	std::unique_ptr<ReplayRecorder> replays;
+	ShardPool shards(threads, tickRate);
+	MatchRegistry registry(maxMatches, shards);
+	if (!replayDir.empty()) {
+		// a chunk being filled per match and as many again waiting for the disk
+		replays.reset(new ReplayRecorder(replayDir, 2 * registry.capacity() + 16));
+		replays->start();
+		registry.setRecorder(replays.get());
+		std::cout << "Recording replays to " << replayDir << std::endl;
+	}
+	// Head shots are checked against the model the clients draw; without it
+	// the head sphere alone decides
+	MeshBvh headMesh;
+	std::vector<std::string> headPaths;
+	if (!headMeshPath.empty())
+		headPaths.push_back(headMeshPath);
+	else
+		headPaths.assign(std::begin(HEAD_MESH_PATHS), std::end(HEAD_MESH_PATHS));
+	for (const std::string& path : headPaths) {
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		if (!ReadObj(path.c_str(), positions, indices) || indices.empty())
+			continue;
+		UnitScale(positions);
+		headMesh.build(positions, indices);
+		std::cout << "Checking head shots against " << path << ", " << headMesh.triangleCount() << " triangles" << std::endl;
+		break;
+	}
+	if (!headMesh.empty())
+		registry.setHeadMesh(&headMesh);
+	else
+		std::cout << "No head mesh, head shots are judged by the sphere alone" << std::endl;
+	BaselineTable baselines;
+	// call counts, handler and tick latencies, bytes per session (Metrics.h)
+	Metrics metrics;
+
 	// Set up rpc server and listen to PORT
 	rpc::server srv(PORT);
-	std::cout << "Listening to port: " << PORT << std::endl;
+	std::cout << "Listening to port: " << PORT << ", ticking at " << tickRate << " Hz on "
+		<< threads << " thread(s), up to " << registry.capacity() << " matches" << std::endl;
 	std::unordered_map<rpc::session_id_t, int> data;
+	std::mutex dataLock;
+
+	// Seat of the calling session; reports an rpc error when every match is taken
+	auto seatOf = [&](Seat& seat) {
+		if (registry.seat(rpc::this_session().id(), seat))
+			return true;
+		rpc::this_handler().respond_error("server full");
+		return false;
+	};
+
+	// One round trip per frame: take the caller's player, return the opponent and
+	// the events since the last tick the caller has seen
+	auto sync = [&](const Seat& seat, const Player& p, uint32_t inputSeq, uint64_t lastTick) {
+		SyncReply reply = {};
+		Match& match = registry.match(seat.match);
+		match.submit(seat.slot, p, inputSeq);
+
+		MatchSnapshot snap = match.snapshot();
+		int other = Match::otherSlot(seat.slot);
+		reply.tick = snap.tick;
+		reply.time = snap.time;
+		reply.opponent = match.isSeated(other);
+		reply.other = snap.players[other];
+		reply.inputSeq = snap.inputSeq[seat.slot];
+		reply.self.fire = snap.players[seat.slot].fire;
+		reply.self.dead = snap.players[seat.slot].dead;
+		AddEvents(snap, seat.slot, lastTick, reply.events);
+		return reply;
+	};
+	// Pose channel: the sync exchange over UDP, without events (PoseChannel.h)
+	PoseServer poses((uint16_t)udpPort, [&](rpc::session_id_t session, const Player& p, uint32_t inputSeq, SyncReply& reply) {
+		Seat seat;
+		if (!registry.seat(session, seat))
+			return false;
+		reply = sync(seat, p, inputSeq, UINT64_MAX);
+		return true;
+	});
+	poses.setLoss(udpLoss);
+	poses.setMetrics(&metrics);
+
+	srv.bind("join", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_JOIN);
+		Seat seat = { 0, 0, 0 };
+		seatOf(seat);
+		return seat;
+	});
+	// what is kept per session, once it left or was reaped
+	auto forget = [&](rpc::session_id_t session) {
+		baselines.forget(session);
+		poses.forget(session);
+		metrics.forget(session);
+	};
+	srv.bind("leave", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_LEAVE);
+		registry.leave(rpc::this_session().id());
+		forget(rpc::this_session().id());
+	});
 
 	// Define a rpc function: auto echo(string const& s, Player& p){} (return type is deduced)
+	// The id argument predates seating by session and is ignored.
 	srv.bind("in", [&](int id, Player &p) {
-		if (id == 1)
-			second = p;
-		else
-			first = p;
+		CallTimer timer(metrics, Metrics::RPC_IN);
+		Seat seat;
+		if (seatOf(seat))
+			registry.match(seat.match).submit(seat.slot, p);
 	});
 	srv.bind("out", [&](int id) {
-		if (id == 1)
-			return first;
-		else
-			return second;
+		CallTimer timer(metrics, Metrics::RPC_OUT);
+		Seat seat;
+		if (!seatOf(seat))
+			return Player();
+		return registry.match(seat.match).snapshot().players[Match::otherSlot(seat.slot)];
+	});
+	srv.bind("sync", [&](Player &p, uint64_t lastTick) {
+		CallTimer timer(metrics, Metrics::RPC_SYNC);
+		Seat seat;
+		if (!seatOf(seat))
+			return SyncReply();
+		return sync(seat, p, 0, lastTick);
+	});
+	// Same as sync, with both directions in the compact encoding of PlayerCodec.h
+	srv.bind("sync_packed", [&](const Packet& request) {
+		CallTimer timer(metrics, Metrics::RPC_SYNC_PACKED);
+		Player p;
+		uint64_t lastTick;
+		if (!UnpackSyncRequest(request, p, lastTick)) {
+			rpc::this_handler().respond_error("malformed sync_packed request");
+			return Packet();
+		}
+		Seat seat;
+		if (!seatOf(seat))
+			return Packet();
+		Packet reply = PackSyncReply(sync(seat, p, 0, lastTick));
+		metrics.traffic(Metrics::RPC_SYNC_PACKED, rpc::this_session().id(), request.size(), reply.size());
+		return reply;
+	});
+	// Same as sync_packed, but the opponent is sent as a delta against the newest
+	// snapshot the client acknowledged having (SnapshotDelta.h)
+	srv.bind("sync_delta", [&](const Packet& request) {
+		CallTimer timer(metrics, Metrics::RPC_SYNC_DELTA);
+		Player p;
+		uint64_t lastTick;
+		uint32_t ackTick;
+		uint32_t inputSeq;
+		if (!UnpackDeltaSyncRequest(request, p, lastTick, ackTick, inputSeq)) {
+			rpc::this_handler().respond_error("malformed sync_delta request");
+			return Packet();
+		}
+		Seat seat;
+		if (!seatOf(seat))
+			return Packet();
+		auto session = rpc::this_session().id();
+		// sessions that dropped without "leave" are cleaned up once they pile up
+		if (baselines.size() > 2 * registry.sessions() + 64)
+			baselines.prune([&](rpc::session_id_t s) { return registry.isSeated(s); });
+		Packet reply = baselines.encode(session, sync(seat, p, inputSeq, lastTick), ackTick);
+		metrics.traffic(Metrics::RPC_SYNC_DELTA, session, request.size(), reply.size());
+		return reply;
+	});
+	// Pose channel setup; token 0 tells the client to stay on sync_delta
+	srv.bind("udp_token", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_UDP_TOKEN);
+		PoseTicket ticket = { 0, 0 };
+		Seat seat;
+		if (udpPort && seatOf(seat)) {
+			ticket.token = poses.ticket(rpc::this_session().id());
+			ticket.port = (uint16_t)udpPort;
+		}
+		return ticket;
+	});
+	// Reliable half of the pose channel: the opponent's events newer than lastTick
+	srv.bind("events", [&](uint64_t lastTick) {
+		CallTimer timer(metrics, Metrics::RPC_EVENTS);
+		EventReply reply = {};
+		Seat seat;
+		if (!seatOf(seat))
+			return reply;
+		MatchSnapshot snap = registry.match(seat.match).snapshot();
+		reply.tick = snap.tick;
+		reply.seating = seat.seating;
+		AddEvents(snap, seat.slot, lastTick, reply.events);
+		return reply;
 	});
 	srv.bind("fire", [&](int id) {
-		if (id == 1)
-			second.fire = true;
-		else
-			first.fire = true;
+		CallTimer timer(metrics, Metrics::RPC_FIRE);
+		Seat seat;
+		if (seatOf(seat))
+			registry.match(seat.match).fire(seat.slot);
+	});
+	// Clock sync sample (ClockSync.h): the caller's match clock, and its start signal
+	srv.bind("clock", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_CLOCK);
+		ClockReply reply = { 0.0, 0.0 };
+		Seat seat;
+		if (!seatOf(seat))
+			return reply;
+		Match& match = registry.match(seat.match);
+		reply.time = match.clock();
+		reply.startAt = match.snapshot().startAt;
+		return reply;
+	});
+	// Hits are decided here, against the opponent as the shooter saw it; the
+	// outcome comes back as EVENT_DIED / EVENT_KILLED
+	srv.bind("shoot", [&](const Shot& shot) {
+		CallTimer timer(metrics, Metrics::RPC_SHOOT);
+		Seat seat;
+		if (seatOf(seat))
+			registry.match(seat.match).shoot(seat.slot, shot);
+	});
+
+	// seqlock counters summed over all matches, to check the handlers and the tick threads are not fighting
+	srv.bind("contention", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_CONTENTION);
+		std::vector<uint64_t> c(9, 0);
+		for (uint32_t id : registry.activeMatches()) {
+			Match& match = registry.match(id);
+			for (int slot = 0; slot < 2; slot++) {
+				auto in = match.inputCounters(slot);
+				c[slot * 3 + 0] += in.publishes;
+				c[slot * 3 + 1] += in.writeContention;
+				c[slot * 3 + 2] += in.readRetries;
+			}
+			auto out = match.snapshotCounters();
+			c[6] += out.publishes;
+			c[7] += out.writeContention;
+			c[8] += out.readRetries;
+		}
+		return c;
+	});
+
+	// tick load of every shard: matches, ticks, dropped ticks and busy fraction
+	srv.bind("shards", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_SHARDS);
+		std::vector<double> c;
+		for (const ShardStats& s : shards.stats())
+			c.insert(c.end(), { (double)s.matches, (double)s.ticks, (double)s.dropped, s.utilization() });
+		return c;
+	});
+
+	// Everything Metrics.h records, plus the session, match and shard counts.
+	// Traffic of sessions that are no longer seated is dropped on the way.
+	auto collectStats = [&]() {
+		ServerStats stats;
+		metrics.prune([&](rpc::session_id_t s) { return registry.isSeated(s); });
+		metrics.fill(stats, TOP_SESSIONS);
+		stats.sessions = registry.sessions();
+		stats.matches = registry.active();
+		for (const ShardStats& s : shards.stats())
+			stats.shards.push_back({ s.index, s.matches, s.ticks, s.dropped, s.utilization(), s.tick });
+		return stats;
+	};
+	srv.bind("stats", [&]() {
+		CallTimer timer(metrics, Metrics::RPC_STATS);
+		return collectStats();
 	});
 
 	srv.bind("store_me_maybe", [&](int identifier) {
 		auto id = rpc::this_session().id();
+		std::lock_guard<std::mutex> lock(dataLock);
 		data[id] = identifier;
 	});
 
+	shards.start();
+	if (udpPort && poses.start()) {
+		std::cout << "Pose channel on udp port " << udpPort;
+		if (udpLoss > 0)
+			std::cout << ", dropping " << udpLoss * 100 << "% of snapshots";
+		std::cout << std::endl;
+	}
+	else {
+		udpPort = 0;
+	}
+
+	// clients that drop never call "leave"; their seats go once they have been quiet for IDLE_TIMEOUT
+	std::atomic<bool> sweeping{ true };
+	std::thread sweeper([&]() {
+		while (sweeping) {
+			std::this_thread::sleep_for(SWEEP_INTERVAL);
+			for (rpc::session_id_t session : registry.reapIdle())
+				forget(session);
+		}
+	});
 
-	// Blocking call to start the server: non-blocking call is srv.async_run(threadsCount);
-	srv.run();
+	std::atomic<bool> dumping{ !metricsFile.empty() };
+	std::thread dumper;
+	if (dumping) {
+		std::cout << "Appending metrics to " << metricsFile << " every " << metricsInterval << " s" << std::endl;
+		dumper = std::thread([&]() {
+			auto next = std::chrono::steady_clock::now();
+			while (dumping) {
+				next += std::chrono::seconds(metricsInterval);
+				std::this_thread::sleep_until(next);
+				std::ofstream out(metricsFile, std::ios::app);
+				if (!out)
+					continue;
+				std::time_t now = std::time(nullptr);
+				std::tm local;
+#ifdef _WIN32
+				localtime_s(&local, &now);
+#else
+				localtime_r(&now, &local);
+#endif
+				out << "--- " << std::put_time(&local, "%Y-%m-%d %H:%M:%S") << std::endl;
+				Metrics::print(out, collectStats());
+			}
+		});
+	}
+
+	if (threads == 1) {
+		// Blocking call to start the server on this thread
+		srv.run();
+	}
+	else {
+		// rpc sessions are served by a pool of workers; matches stay pinned to their shard
+		srv.async_run(threads);
+		for (;;) {
+			std::this_thread::sleep_for(STATS_INTERVAL);
+			std::cout << registry.sessions() << " sessions in " << registry.active() << " matches" << std::endl;
+			PrintShardStats(shards);
+			PoseStats p = poses.stats();
+			std::cout << "poses: " << p.received << " received, " << p.stale << " stale, " << p.rejected << " rejected, "
+				<< p.sent << " snapshots sent, " << p.dropped << " dropped" << std::endl;
+			if (replays) {
+				ReplayStats r = replays->stats();
+				std::cout << "replays: " << r.recordings << " recordings, " << r.bytes / 1024 << " KiB in "
+					<< r.chunks << " chunks, " << r.dropped << " ticks dropped" << std::endl;
+			}
+		}
+	}
+	dumping = false;
+	if (dumper.joinable())
+		dumper.join();
+	sweeping = false;
+	sweeper.join();
+	poses.stop();
+	shards.stop();
+	if (replays)
+		replays->stop();
 	return 0;
 }
@@ -0,0 +1,91 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "ShardPool.h"
+
+Shard::Shard(int index, int hz) :
+	index(index),
+	loop(hz, [this](uint64_t tick, double dt) { this->tick(tick, dt); }) {
+}
+
+// utilization counts from here: setting up the server before is not idle time
+void Shard::start() {
+	startedAt.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+	loop.start();
+}
+
+void Shard::post(std::function<void()> task) {
+	std::lock_guard<std::mutex> lock(taskLock);
+	tasks.push_back(task);
+}
+
+void Shard::attach(Match* match) {
+	matches.push_back(match);
+	matchCount = matches.size();
+}
+
+void Shard::detach(Match* match) {
+	matches.erase(std::remove(matches.begin(), matches.end(), match), matches.end());
+	matchCount = matches.size();
+}
+
+void Shard::tick(uint64_t tick, double dt) {
+	auto begin = std::chrono::steady_clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(taskLock);
+		running.swap(tasks);
+	}
+	for (auto& task : running)
+		task();
+	running.clear();
+
+	for (Match* match : matches)
+		match->tick(dt);
+
+	auto spent = std::chrono::steady_clock::now() - begin;
+	busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count(), std::memory_order_relaxed);
+	tickTime.record(spent);
+}
+
+ShardStats Shard::stats() const {
+	ShardStats s;
+	s.index = index;
+	s.matches = matchCount.load();
+	s.ticks = loop.ticks();
+	s.dropped = loop.dropped();
+	s.busySeconds = busyNs.load(std::memory_order_relaxed) * 1e-9;
+	int64_t started = startedAt.load(std::memory_order_relaxed);
+	auto wall = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(started);
+	s.wallSeconds = started ? std::chrono::duration<double>(wall).count() : 0.0;
+	s.tick = tickTime.summary();
+	return s;
+}
+
+ShardPool::ShardPool(int count, int hz) {
+	count = std::max(count, 1);
+	for (int i = 0; i < count; i++)
+		shards.emplace_back(new Shard(i, hz));
+}
+
+ShardPool::~ShardPool() {
+	stop();
+}
+
+void ShardPool::start() {
+	for (auto& shard : shards)
+		shard->start();
+}
+
+void ShardPool::stop() {
+	for (auto& shard : shards)
+		shard->stop();
+}
+
+std::vector<ShardStats> ShardPool::stats() const {
+	std::vector<ShardStats> all;
+	for (auto& shard : shards)
+		all.push_back(shard->stats());
+	return all;
+}
@@ -0,0 +1,84 @@
+#ifndef SHARDPOOL_H
+#define SHARDPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Match.h"
+#include "Metrics.h"
+#include "TickLoop.h"
+
+// Per-shard numbers for the utilization report
+struct ShardStats {
+	int index;
+	size_t matches;
+	uint64_t ticks;
+	uint64_t dropped;
+	double busySeconds;
+	double wallSeconds;
+	LatencySummary tick; // time spent in one tick
+	double utilization() const { return wallSeconds > 0 ? busySeconds / wallSeconds : 0.0; }
+};
+
+// One tick thread and the matches pinned to it. Everything that touches the
+// state of those matches runs on this thread, so it acts as the matches' strand.
+class Shard {
+public:
+	Shard(int index, int hz);
+
+	void start();
+	void stop() { loop.stop(); }
+
+	// queue work to run on the shard thread before its next tick
+	void post(std::function<void()> task);
+
+	// shard thread only
+	void attach(Match* match);
+	void detach(Match* match);
+
+	ShardStats stats() const;
+
+private:
+	void tick(uint64_t tick, double dt);
+
+	int index;
+	TickLoop loop;
+	std::vector<Match*> matches;
+	std::atomic<size_t> matchCount{ 0 };
+
+	std::mutex taskLock;
+	std::vector<std::function<void()>> tasks;
+	std::vector<std::function<void()>> running;
+
+	std::atomic<int64_t> startedAt{ 0 }; // steady clock ticks, 0 until start()
+	std::atomic<int64_t> busyNs{ 0 };
+	LatencyHistogram tickTime;
+};
+
+// Fixed set of shards; a match always lives on shard (match id % shard count).
+class ShardPool {
+public:
+	ShardPool(int shards, int hz);
+	~ShardPool();
+
+	void start();
+	void stop();
+
+	size_t size() const { return shards.size(); }
+	Shard& shardFor(uint32_t matchId) { return *shards[matchId % shards.size()]; }
+
+	// run on the strand of the given match
+	void post(uint32_t matchId, std::function<void()> task) { shardFor(matchId).post(task); }
+
+	std::vector<ShardStats> stats() const;
+
+private:
+	std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif
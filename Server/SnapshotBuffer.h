@@ -0,0 +1,97 @@
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Seqlock around a trivially copyable value.
+// Readers never block a writer and never take a lock: they copy the value and
+// retry if a write overlapped the copy. Writers bump the sequence to an odd
+// number while they write; concurrent writers serialize on that CAS.
+// The payload is kept in atomic words so the racy copy is well defined.
+template <typename T>
+class SnapshotBuffer {
+	static_assert(std::is_trivially_copyable<T>::value, "SnapshotBuffer needs a trivially copyable type");
+
+public:
+	struct Counters {
+		uint64_t publishes;
+		uint64_t writeContention; // writer found another write in progress
+		uint64_t readRetries;     // reader copy was torn by a write and redone
+	};
+
+	SnapshotBuffer() {
+		store(T());
+	}
+
+	explicit SnapshotBuffer(const T& initial) {
+		store(initial);
+	}
+
+	void publish(const T& value) {
+		uint64_t s = seq.load(std::memory_order_relaxed);
+		for (;;) {
+			if (!(s & 1) && seq.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+				break;
+			writeContention.fetch_add(1, std::memory_order_relaxed);
+			s = seq.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		store(value);
+		seq.store(s + 2, std::memory_order_release);
+		publishes.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	T read() const {
+		uint64_t buf[WORDS];
+		for (;;) {
+			uint64_t s1 = seq.load(std::memory_order_acquire);
+			if (!(s1 & 1)) {
+				for (size_t i = 0; i < WORDS; i++)
+					buf[i] = words[i].load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (seq.load(std::memory_order_relaxed) == s1)
+					break;
+			}
+			readRetries.fetch_add(1, std::memory_order_relaxed);
+		}
+		T value;
+		std::memcpy(&value, buf, sizeof(T));
+		return value;
+	}
+
+	// number of completed publishes; cheap way for a reader to tell whether anything changed
+	uint64_t version() const {
+		return seq.load(std::memory_order_acquire) >> 1;
+	}
+
+	Counters counters() const {
+		Counters c;
+		c.publishes = publishes.load(std::memory_order_relaxed);
+		c.writeContention = writeContention.load(std::memory_order_relaxed);
+		c.readRetries = readRetries.load(std::memory_order_relaxed);
+		return c;
+	}
+
+private:
+	static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	void store(const T& value) {
+		uint64_t buf[WORDS] = {};
+		std::memcpy(buf, &value, sizeof(T));
+		for (size_t i = 0; i < WORDS; i++)
+			words[i].store(buf[i], std::memory_order_relaxed);
+	}
+
+	alignas(64) std::atomic<uint64_t> seq{ 0 };
+	std::atomic<uint64_t> words[WORDS];
+
+	// kept off the data cache lines so counting does not slow down readers
+	alignas(64) std::atomic<uint64_t> publishes{ 0 };
+	std::atomic<uint64_t> writeContention{ 0 };
+	mutable std::atomic<uint64_t> readRetries{ 0 };
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "pch.h"
+
+#include "TickLoop.h"
+
+TickLoop::TickLoop(int hz, TickFn fn) : hz(hz > 0 ? hz : DEFAULT_RATE), onTick(fn) {
+}
+
+TickLoop::~TickLoop() {
+	stop();
+}
+
+void TickLoop::start() {
+	if (running.exchange(true))
+		return;
+	worker = std::thread(&TickLoop::run, this);
+}
+
+void TickLoop::stop() {
+	running = false;
+	if (worker.joinable())
+		worker.join();
+}
+
+void TickLoop::run() {
+	typedef std::chrono::steady_clock clock;
+	const auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(period()));
+	const double dt = period();
+
+	auto base = clock::now();
+	uint64_t scheduled = 0;
+
+	while (running) {
+		auto now = clock::now();
+		uint64_t due = (uint64_t)((now - base) / step);
+
+		// fell too far behind (debugger, machine stall): drop the backlog and rebase
+		if (due > scheduled + MAX_CATCH_UP) {
+			droppedCount.fetch_add(due - scheduled - MAX_CATCH_UP, std::memory_order_relaxed);
+			scheduled = due - MAX_CATCH_UP;
+		}
+
+		while (scheduled <= due && running) {
+			onTick(tickCount.load(std::memory_order_relaxed), dt);
+			tickCount.fetch_add(1, std::memory_order_relaxed);
+			++scheduled;
+		}
+
+		std::this_thread::sleep_until(base + step * scheduled);
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef TICKLOOP_H
+#define TICKLOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+// Runs a callback at a fixed rate on its own thread.
+// Ticks are scheduled against an absolute timeline (start + n * period) so sleep
+// jitter does not accumulate; if the loop falls behind it runs up to
+// MAX_CATCH_UP ticks back to back and then drops the rest of the backlog.
+class TickLoop {
+public:
+	typedef std::function<void(uint64_t tick, double dt)> TickFn;
+
+	static const int DEFAULT_RATE = 90;
+	static const int MAX_CATCH_UP = 5;
+
+	TickLoop(int hz, TickFn fn);
+	~TickLoop();
+
+	void start();
+	void stop();
+
+	int rate() const { return hz; }
+	double period() const { return 1.0 / hz; }
+	uint64_t ticks() const { return tickCount.load(std::memory_order_relaxed); }
+	// ticks that were skipped because the loop fell too far behind
+	uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+	void run();
+
+	int hz;
+	TickFn onTick;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> tickCount{ 0 };
+	std::atomic<uint64_t> droppedCount{ 0 };
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "Aabb.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AABB_SSE 1
+#include <emmintrin.h>
+#endif
+
+Aabb BoundsOf(const std::vector<glm::vec3>& vertices) {
+	if (vertices.empty())
+		return { glm::vec3(0.0f), glm::vec3(0.0f) };
+	Aabb box = { vertices[0], vertices[0] };
+	for (const glm::vec3& v : vertices) {
+		box.lo = glm::min(box.lo, v);
+		box.hi = glm::max(box.hi, v);
+	}
+	return box;
+}
+
+void AabbSoA::clear() {
+	resize(0);
+}
+
+void AabbSoA::resize(size_t n) {
+	loX.resize(n);
+	loY.resize(n);
+	loZ.resize(n);
+	hiX.resize(n);
+	hiY.resize(n);
+	hiZ.resize(n);
+}
+
+uint32_t AabbSoA::add(const Aabb& box) {
+	loX.push_back(box.lo.x);
+	loY.push_back(box.lo.y);
+	loZ.push_back(box.lo.z);
+	hiX.push_back(box.hi.x);
+	hiY.push_back(box.hi.y);
+	hiZ.push_back(box.hi.z);
+	return (uint32_t)(loX.size() - 1);
+}
+
+static void Store(AabbSoA& out, size_t i, const Aabb& box) {
+	out.loX[i] = box.lo.x;
+	out.loY[i] = box.lo.y;
+	out.loZ[i] = box.lo.z;
+	out.hiX[i] = box.hi.x;
+	out.hiY[i] = box.hi.y;
+	out.hiZ[i] = box.hi.z;
+}
+
+#ifdef AABB_SSE
+// One box with the matrix columns as SSE registers; the w lane is don't-care
+static inline void Transform(const glm::mat4& m, const Aabb& local, __m128& lo, __m128& hi) {
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 c0 = _mm_loadu_ps(&m[0].x), c1 = _mm_loadu_ps(&m[1].x), c2 = _mm_loadu_ps(&m[2].x);
+	__m128 centre = _mm_loadu_ps(&m[3].x);
+	centre = _mm_add_ps(centre, _mm_mul_ps(c0, _mm_set1_ps((local.lo.x + local.hi.x) * 0.5f)));
+	centre = _mm_add_ps(centre, _mm_mul_ps(c1, _mm_set1_ps((local.lo.y + local.hi.y) * 0.5f)));
+	centre = _mm_add_ps(centre, _mm_mul_ps(c2, _mm_set1_ps((local.lo.z + local.hi.z) * 0.5f)));
+	__m128 half = _mm_mul_ps(_mm_and_ps(c0, absMask), _mm_set1_ps((local.hi.x - local.lo.x) * 0.5f));
+	half = _mm_add_ps(half, _mm_mul_ps(_mm_and_ps(c1, absMask), _mm_set1_ps((local.hi.y - local.lo.y) * 0.5f)));
+	half = _mm_add_ps(half, _mm_mul_ps(_mm_and_ps(c2, absMask), _mm_set1_ps((local.hi.z - local.lo.z) * 0.5f)));
+	lo = _mm_sub_ps(centre, half);
+	hi = _mm_add_ps(centre, half);
+}
+#endif
+
+// Four boxes at a time are transposed from one box per register to one
+// component per register and stored straight into the arrays.
+void TransformAabbs(const glm::mat4* transforms, const Aabb* local, size_t n, AabbSoA& out) {
+	// shrinking keeps the capacity, so a reused out does not reallocate
+	out.resize(n);
+	size_t i = 0;
+#ifdef AABB_SSE
+	for (; i + 4 <= n; i += 4) {
+		__m128 lo0, lo1, lo2, lo3, hi0, hi1, hi2, hi3;
+		Transform(transforms[i], local[i], lo0, hi0);
+		Transform(transforms[i + 1], local[i + 1], lo1, hi1);
+		Transform(transforms[i + 2], local[i + 2], lo2, hi2);
+		Transform(transforms[i + 3], local[i + 3], lo3, hi3);
+		_MM_TRANSPOSE4_PS(lo0, lo1, lo2, lo3);
+		_MM_TRANSPOSE4_PS(hi0, hi1, hi2, hi3);
+		_mm_storeu_ps(&out.loX[i], lo0);
+		_mm_storeu_ps(&out.loY[i], lo1);
+		_mm_storeu_ps(&out.loZ[i], lo2);
+		_mm_storeu_ps(&out.hiX[i], hi0);
+		_mm_storeu_ps(&out.hiY[i], hi1);
+		_mm_storeu_ps(&out.hiZ[i], hi2);
+	}
+#endif
+	for (; i < n; i++)
+		Store(out, i, TransformAabb(transforms[i], local[i]));
+}
@@ -0,0 +1,64 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct Aabb {
+	glm::vec3 lo;
+	glm::vec3 hi;
+};
+
+// The local box around a model's vertices, e.g. Model::boxVertices
+Aabb BoundsOf(const std::vector<glm::vec3>& vertices);
+
+// The world box around a local box under an affine transform, by Arvo's
+// method: the centre goes through the matrix and the half extents through its
+// absolute values. No corners, no allocation.
+inline Aabb TransformAabb(const glm::mat4& m, const Aabb& local) {
+	glm::vec3 centre = (local.lo + local.hi) * 0.5f;
+	glm::vec3 half = (local.hi - local.lo) * 0.5f;
+	glm::vec3 c = glm::vec3(m[3]) + glm::vec3(m[0]) * centre.x + glm::vec3(m[1]) * centre.y + glm::vec3(m[2]) * centre.z;
+	glm::vec3 e = glm::abs(glm::vec3(m[0])) * half.x + glm::abs(glm::vec3(m[1])) * half.y + glm::abs(glm::vec3(m[2])) * half.z;
+	return { c - e, c + e };
+}
+
+// 1 / d for slab tests, with a direction parallel to an axis given a huge
+// finite slope instead of an infinite one: 0 * inf would be NaN for a ray or
+// segment lying on a box face
+inline float SlabInverse(float d) {
+	return std::fabs(d) < 1e-30f ? 1e30f : 1.0f / d;
+}
+
+// the smallest box around both
+inline Aabb Union(const Aabb& a, const Aabb& b) {
+	return { glm::min(a.lo, b.lo), glm::max(a.hi, b.hi) };
+}
+
+// strict, boxes that only touch do not overlap
+inline bool Overlaps(const Aabb& a, const Aabb& b) {
+	return a.hi.x > b.lo.x && a.hi.y > b.lo.y && a.hi.z > b.lo.z
+		&& a.lo.x < b.hi.x && a.lo.y < b.hi.y && a.lo.z < b.hi.z;
+}
+
+// Boxes kept one component per array, for tests that take four at a time
+class AabbSoA {
+public:
+	void clear();
+	void resize(size_t n);
+	// returns the box's index
+	uint32_t add(const Aabb& box);
+	size_t size() const { return loX.size(); }
+
+	std::vector<float> loX, loY, loZ;
+	std::vector<float> hiX, hiY, hiZ;
+};
+
+// TransformAabb over n boxes, each with its own matrix; out holds exactly those n
+void TransformAabbs(const glm::mat4* transforms, const Aabb* local, size_t n, AabbSoA& out);
+
+#endif
@@ -0,0 +1,258 @@
+#include "AabbTree.h"
+
+#include <algorithm>
+
+// steps of the last move a reinserted box is grown by
+static const float LOOKAHEAD = 4.0f;
+
+// half the surface area, which is all the insertion cost needs
+static float Area(const Aabb& box) {
+	glm::vec3 d = box.hi - box.lo;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static bool Contains(const Aabb& outer, const Aabb& inner) {
+	return outer.lo.x <= inner.lo.x && outer.lo.y <= inner.lo.y && outer.lo.z <= inner.lo.z
+		&& outer.hi.x >= inner.hi.x && outer.hi.y >= inner.hi.y && outer.hi.z >= inner.hi.z;
+}
+
+AabbTree::AabbTree(float margin) : margin(margin), root(NONE), freeList(NONE), leaves(0) {
+}
+
+int AabbTree::allocate() {
+	if (freeList == NONE) {
+		nodes.push_back(Node());
+		freeList = (int)nodes.size() - 1;
+		nodes[freeList].parent = NONE;
+	}
+	int node = freeList;
+	freeList = nodes[node].parent;
+	Node& n = nodes[node];
+	n.parent = NONE;
+	n.left = NONE;
+	n.right = NONE;
+	n.height = 0;
+	n.user = 0;
+	return node;
+}
+
+void AabbTree::release(int node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+int AabbTree::insert(const Aabb& box, uint32_t user) {
+	int leaf = allocate();
+	Node& n = nodes[leaf];
+	n.tight = box;
+	n.fat = { box.lo - glm::vec3(margin), box.hi + glm::vec3(margin) };
+	n.user = user;
+	insertLeaf(leaf);
+	leaves++;
+	return leaf;
+}
+
+void AabbTree::remove(int proxy) {
+	removeLeaf(proxy);
+	release(proxy);
+	leaves--;
+}
+
+bool AabbTree::move(int proxy, const Aabb& box) {
+	Node& n = nodes[proxy];
+	glm::vec3 displacement = (box.lo + box.hi - n.tight.lo - n.tight.hi) * 0.5f;
+	n.tight = box;
+	if (Contains(n.fat, box))
+		return false;
+	removeLeaf(proxy);
+	// grown further along the way it moved, as it is likely to keep going
+	glm::vec3 ahead = displacement * LOOKAHEAD;
+	nodes[proxy].fat = { box.lo - glm::vec3(margin) + glm::min(ahead, glm::vec3(0.0f)),
+		box.hi + glm::vec3(margin) + glm::max(ahead, glm::vec3(0.0f)) };
+	insertLeaf(proxy);
+	return true;
+}
+
+// Walks down to the sibling that makes the new branch cheapest, counting what
+// every branch above it grows by on the way
+void AabbTree::insertLeaf(int leaf) {
+	if (root == NONE) {
+		root = leaf;
+		nodes[leaf].parent = NONE;
+		return;
+	}
+	Aabb box = nodes[leaf].fat;
+	int index = root;
+	while (nodes[index].left != NONE) {
+		const Node& n = nodes[index];
+		float area = Area(n.fat);
+		float combined = Area(Union(n.fat, box));
+		// a new branch here, above both children
+		float cost = 2.0f * combined;
+		float inherited = 2.0f * (combined - area);
+		float costs[2];
+		int children[2] = { n.left, n.right };
+		for (int c = 0; c < 2; c++) {
+			const Node& child = nodes[children[c]];
+			float grown = Area(Union(child.fat, box));
+			costs[c] = (child.left == NONE ? grown : grown - Area(child.fat)) + inherited;
+		}
+		if (cost < costs[0] && cost < costs[1])
+			break;
+		index = costs[0] < costs[1] ? children[0] : children[1];
+	}
+
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int branch = allocate();
+	Node& b = nodes[branch];
+	b.parent = oldParent;
+	b.fat = Union(box, nodes[sibling].fat);
+	b.height = nodes[sibling].height + 1;
+	b.left = sibling;
+	b.right = leaf;
+	if (oldParent == NONE)
+		root = branch;
+	else if (nodes[oldParent].left == sibling)
+		nodes[oldParent].left = branch;
+	else
+		nodes[oldParent].right = branch;
+	nodes[sibling].parent = branch;
+	nodes[leaf].parent = branch;
+	refit(nodes[leaf].parent);
+}
+
+void AabbTree::removeLeaf(int leaf) {
+	if (leaf == root) {
+		root = NONE;
+		return;
+	}
+	int parent = nodes[leaf].parent;
+	int grand = nodes[parent].parent;
+	int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+	release(parent);
+	nodes[sibling].parent = grand;
+	if (grand == NONE) {
+		root = sibling;
+		return;
+	}
+	if (nodes[grand].left == parent)
+		nodes[grand].left = sibling;
+	else
+		nodes[grand].right = sibling;
+	refit(grand);
+}
+
+// Boxes and heights from node up to the root, balancing on the way
+void AabbTree::refit(int node) {
+	while (node != NONE) {
+		node = balance(node);
+		Node& n = nodes[node];
+		n.height = 1 + std::max(nodes[n.left].height, nodes[n.right].height);
+		n.fat = Union(nodes[n.left].fat, nodes[n.right].fat);
+		node = n.parent;
+	}
+}
+
+// A branch whose children differ in height by more than one has its taller
+// child rotated up in its place. Returns the branch now in that place.
+int AabbTree::balance(int a) {
+	Node& A = nodes[a];
+	if (A.left == NONE || A.height < 2)
+		return a;
+	int b = A.left, c = A.right;
+	Node& B = nodes[b];
+	Node& C = nodes[c];
+	int diff = C.height - B.height;
+	if (diff > -2 && diff < 2)
+		return a;
+
+	// up is the taller child, which takes a's place; stay is the other one
+	int up = diff > 1 ? c : b;
+	int stay = diff > 1 ? b : c;
+	Node& U = nodes[up];
+	int f = U.left, g = U.right;
+	Node& F = nodes[f];
+	Node& G = nodes[g];
+
+	U.parent = A.parent;
+	A.parent = up;
+	if (U.parent == NONE)
+		root = up;
+	else if (nodes[U.parent].left == a)
+		nodes[U.parent].left = up;
+	else
+		nodes[U.parent].right = up;
+
+	// a keeps stay and takes up's shorter child; up keeps the taller one and a
+	int tall = F.height > G.height ? f : g;
+	int shortChild = F.height > G.height ? g : f;
+	U.left = a;
+	U.right = tall;
+	if (up == c)
+		A.right = shortChild;
+	else
+		A.left = shortChild;
+	nodes[shortChild].parent = a;
+
+	A.fat = Union(nodes[stay].fat, nodes[shortChild].fat);
+	A.height = 1 + std::max(nodes[stay].height, nodes[shortChild].height);
+	U.fat = Union(A.fat, nodes[tall].fat);
+	U.height = 1 + std::max(A.height, nodes[tall].height);
+	return up;
+}
+
+void AabbTree::query(const Aabb& box, std::vector<int>& hits) const {
+	if (root == NONE)
+		return;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		int index = stack.back();
+		stack.pop_back();
+		const Node& n = nodes[index];
+		if (!Overlaps(n.fat, box))
+			continue;
+		if (n.left == NONE) {
+			if (Overlaps(n.tight, box))
+				hits.push_back(index);
+		}
+		else {
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+}
+
+// The tree against itself: the two children of every branch are checked
+// against each other, descending into whichever of an overlapping pair is
+// not a leaf, so a pair of leaves comes up exactly once
+void AabbTree::pairs(const PairHandler& handler) const {
+	pairStack.clear();
+	for (int index = 0; index < (int)nodes.size(); index++) {
+		if (nodes[index].height > 0)
+			pairStack.push_back({ nodes[index].left, nodes[index].right });
+	}
+	while (!pairStack.empty()) {
+		std::pair<int, int> top = pairStack.back();
+		pairStack.pop_back();
+		const Node& a = nodes[top.first];
+		const Node& b = nodes[top.second];
+		if (!Overlaps(a.fat, b.fat))
+			continue;
+		bool aLeaf = a.left == NONE, bLeaf = b.left == NONE;
+		if (aLeaf && bLeaf) {
+			if (Overlaps(a.tight, b.tight))
+				handler(a.user, b.user);
+		}
+		else if (bLeaf || (!aLeaf && a.height >= b.height)) {
+			pairStack.push_back({ a.left, top.second });
+			pairStack.push_back({ a.right, top.second });
+		}
+		else {
+			pairStack.push_back({ top.first, b.left });
+			pairStack.push_back({ top.first, b.right });
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef AABB_TREE_H
+#define AABB_TREE_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Aabb.h"
+
+// Broad phase for boxes that move every tick: a dynamic bounding volume tree
+// whose leaves hold each box grown by a margin, and by a few steps of its last
+// move when it is reinserted. A box that moves but stays inside its grown box
+// costs nothing; one that leaves it is taken out and put back where it grows
+// the tree the least, and rotations keep the tree balanced.
+// Proxies are the ids insert hands out; user is whatever the caller maps them to.
+class AabbTree {
+public:
+	static const int NONE = -1;
+
+	typedef std::function<void(uint32_t, uint32_t)> PairHandler;
+
+	explicit AabbTree(float margin = 0.05f);
+
+	int insert(const Aabb& box, uint32_t user);
+	void remove(int proxy);
+	// returns true when the proxy had to be reinserted
+	bool move(int proxy, const Aabb& box);
+
+	const Aabb& box(int proxy) const { return nodes[proxy].tight; }
+	uint32_t user(int proxy) const { return nodes[proxy].user; }
+	size_t size() const { return leaves; }
+	int height() const { return root == NONE ? 0 : nodes[root].height; }
+
+	// appends every proxy whose box overlaps the given one
+	void query(const Aabb& box, std::vector<int>& hits) const;
+	// every pair of proxies whose boxes overlap, once each, as (user, user)
+	void pairs(const PairHandler& handler) const;
+
+private:
+	struct Node {
+		Aabb fat;      // leaves: the box grown by the margin; branches: around both children
+		Aabb tight;    // leaves only
+		uint32_t user;
+		int parent;    // the next free node while on the free list
+		int left;      // NONE on leaves
+		int right;
+		int height;    // 0 on leaves, -1 while free
+	};
+
+	int allocate();
+	void release(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	void refit(int node);
+	int balance(int a);
+
+	float margin;
+	std::vector<Node> nodes;
+	int root;
+	int freeList;
+	size_t leaves;
+	mutable std::vector<int> stack;
+	mutable std::vector<std::pair<int, int>> pairStack;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// How the two tracking spaces are put together. Each client stays at its own
+// origin and sees the opponent's space OPPONENT_OFFSET down its own -z, moved
+// but not turned; the opponent's model is turned round to face the viewer
+// instead. The server judges a shot in the shooter's space with the same
+// placement, so a shot hits what the shooter saw.
+namespace arena
+{
+	const glm::vec3 OPPONENT_OFFSET(0.0f, 0.0f, -4.5f);
+	const float HEAD_SCALE = 0.3f; // metres across the head model's largest side
+
+	// a point of the opponent's tracking space, in the viewer's
+	inline glm::vec3 OpponentToView(const glm::vec3& p) {
+		return p + OPPONENT_OFFSET;
+	}
+
+	// the opponent's head model (unit sized, Model::scaleProcess) in the
+	// viewer's space: at the tracked head, turned round to face the viewer
+	inline glm::mat4 OpponentHead(const glm::vec3& headPos, const glm::quat& rotation) {
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), OpponentToView(headPos));
+		m = glm::scale(m, glm::vec3(HEAD_SCALE));
+		m = m * glm::mat4_cast(rotation);
+		return glm::rotate(m, glm::pi<float>(), glm::vec3(0, 1, 0));
+	}
+}
+
+#endif
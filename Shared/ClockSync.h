@@ -0,0 +1,101 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <algorithm>
+#include <cmath>
+
+// NTP style estimate of the offset between a local clock and the server's.
+// Each sample is one "clock" round trip: local send time, the server's time as
+// it answered, local receive time. Assuming the two legs took equally long,
+// offset = server - (send + receive) / 2, off by at most half the round trip.
+// Samples that sat in a queue on either leg have a long round trip and a skewed
+// offset, so only the ones close to the fastest round trip in the window count,
+// and the estimate is their median. Once synced the offset slews instead of
+// jumping so timelines built on it stay monotonic.
+class ClockSync {
+public:
+	static const int WINDOW = 16;               // samples considered
+	static const int MIN_SAMPLES = 4;           // before the first estimate
+	static constexpr double RTT_TOLERANCE = 1.5; // accept rtt up to this times the fastest...
+	static constexpr double RTT_SLACK = 0.002;   // ...plus this, in seconds
+	static constexpr double MAX_SLEW = 0.002;    // offset change per sample once synced
+	static constexpr double RESYNC = 0.100;      // an error this large is a jump, not drift
+
+	ClockSync() { reset(); }
+
+	void reset() {
+		count = 0;
+		next = 0;
+		synced = false;
+		estimate = 0.0;
+		roundTrip = 0.0;
+		rejected = 0;
+	}
+
+	// all times in seconds; local ones from a monotonic clock
+	void addSample(double sent, double serverTime, double received) {
+		if (received < sent)
+			return;
+		samples[next] = { received - sent, serverTime - (sent + received) * 0.5 };
+		next = (next + 1) % WINDOW;
+		if (count < WINDOW)
+			count++;
+		if (count >= MIN_SAMPLES)
+			update();
+	}
+
+	bool ready() const { return synced; }
+	// server time - local time
+	double offset() const { return estimate; }
+	// round trip of the fastest sample in the window
+	double rtt() const { return roundTrip; }
+	double serverTime(double local) const { return local + estimate; }
+	// samples left out of the latest estimate for their round trip
+	int outliers() const { return rejected; }
+
+private:
+	struct Sample {
+		double rtt;
+		double offset;
+	};
+
+	void update() {
+		double fastest = samples[0].rtt;
+		for (int i = 1; i < count; i++)
+			fastest = std::min(fastest, samples[i].rtt);
+		double limit = fastest * RTT_TOLERANCE + RTT_SLACK;
+		rejected = 0;
+
+		double offsets[WINDOW];
+		int n = 0;
+		for (int i = 0; i < count; i++) {
+			if (samples[i].rtt <= limit)
+				offsets[n++] = samples[i].offset;
+			else
+				rejected++;
+		}
+		std::nth_element(offsets, offsets + n / 2, offsets + n);
+		double median = offsets[n / 2];
+
+		roundTrip = fastest;
+		double error = median - estimate;
+		if (!synced || std::fabs(error) > RESYNC)
+			estimate = median;
+		else {
+			// std::min/max bind references, and the member has no definition
+			const double slew = MAX_SLEW;
+			estimate += std::max(-slew, std::min(slew, error));
+		}
+		synced = true;
+	}
+
+	Sample samples[WINDOW];
+	int count;
+	int next;
+	bool synced;
+	double estimate;
+	double roundTrip;
+	int rejected;
+};
+
+#endif
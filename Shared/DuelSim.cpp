@@ -0,0 +1,173 @@
+#include "DuelSim.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+void DuelSim::reset() {
+	gameStart = false;
+	pickedUp = false;
+	fire = false;
+	fired = false;
+	finishFire = false;
+	dead = false;
+	wins = false;
+	handOnGun = false;
+	gunBox = glm::mat4(1.0f);
+	handBox = glm::mat4(1.0f);
+	bullet = { glm::mat4(1.0f), glm::vec3(0.0f), BULLET_LIFE };
+	otherBullet = bullet;
+}
+
+void DuelSim::setBoxes(const std::vector<glm::vec3>& gun, const std::vector<glm::vec3>& hand) {
+	gunLocal = BoundsOf(gun);
+	handLocal = BoundsOf(hand);
+}
+
+void DuelSim::pullTrigger() {
+	if (gameStart && pickedUp)
+		fire = true;
+}
+
+unsigned DuelSim::step(const DuelInput& in, Player& opponent) {
+	unsigned events = 0;
+	// both clients start on the same server signal, not on their own timers
+	if (in.clockSynced && in.startAt > 0.0 && in.now >= in.startAt)
+		gameStart = true;
+	if (!dead)
+		localStep(in, opponent, events);
+	opponentStep(opponent, events);
+
+	if (in.opponentHit) {
+		wins = true;
+		opponent.dead = true;
+		events |= DUEL_WON;
+	}
+	if (opponent.dead)
+		opponent.fire = false;
+	if (in.localHit) {
+		wins = false;
+		dead = true;
+		fire = false;
+		events |= DUEL_LOST;
+	}
+	return events;
+}
+
+void DuelSim::localStep(const DuelInput& in, Player& opponent, unsigned& events) {
+	glm::mat4 toHand = glm::translate(glm::mat4(1.0f), in.handPos);
+	glm::mat4 fromHand = glm::translate(glm::mat4(1.0f), -in.handPos);
+	if (!pickedUp) {
+		// the gun waits at the hip until it is grabbed
+		glm::mat4 hip = glm::translate(glm::mat4(1.0f), in.headPos + glm::vec3(0.2f, -0.4f, 0.0f));
+		gunBox = hip * glm::scale(glm::mat4(1.0f), glm::vec3(0.08f)) * fromHand;
+		handBox = toHand * in.handRotation * glm::scale(glm::mat4(1.0f), glm::vec3(0.1f)) * fromHand
+			* glm::rotate(glm::mat4(1.0f), 1.01f * glm::pi<float>(), glm::vec3(0, 1, 0));
+	}
+	if (in.grip && gameStart) {
+		// the world boxes first, the turned ones only when those touch
+		handOnGun = Overlaps(TransformAabb(gunBox, gunLocal), TransformAabb(handBox, handLocal))
+			&& ObbOverlap(OrientedBox(gunBox, gunLocal), OrientedBox(handBox, handLocal));
+		if (handOnGun)
+			pickedUp = true;
+	}
+	if (pickedUp)
+		opponent.pickedUp = true;
+
+	if (!fire) {
+		bullet.viewdir = in.shootDir;
+	}
+	else if (gameStart && pickedUp) {
+		opponent.fire = true;
+		finishFire = false;
+		if (!fired)
+			events |= DUEL_SHOT;
+		bullet.toWorld = glm::translate(glm::mat4(1.0f), bullet.viewdir) * bullet.toWorld;
+		bullet.duration--;
+		events |= DUEL_FIRING;
+		fired = true;
+	}
+	if (finishFire) {
+		bullet.toWorld = toHand * in.handRotation * fromHand;
+		bullet.duration = BULLET_LIFE;
+		fired = false;
+	}
+	if (bullet.duration == 0) {
+		finishFire = true;
+		fire = false;
+	}
+}
+
+void DuelSim::opponentStep(Player& opponent, unsigned& events) {
+	if (!opponent.fire) {
+		otherBullet.viewdir = opponent.shootDir;
+	}
+	else if (gameStart && opponent.pickedUp) {
+		opponent.finishFire = false;
+		otherBullet.toWorld = glm::translate(glm::mat4(1.0f), otherBullet.viewdir) * otherBullet.toWorld;
+		otherBullet.duration--;
+		events |= DUEL_FIRING;
+	}
+	opponent.fired = false;
+	if (opponent.finishFire) {
+		otherBullet.toWorld = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -10.0f));
+		otherBullet.duration = BULLET_LIFE;
+	}
+	if (otherBullet.duration <= 0) {
+		opponent.finishFire = true;
+		opponent.fire = false;
+	}
+}
+
+static void Mix(uint64_t& h, const void* data, size_t size) {
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+}
+
+static void MixBullet(uint64_t& h, const SimBullet& b) {
+	Mix(h, &b.toWorld[0].x, sizeof(float) * 16);
+	Mix(h, &b.viewdir.x, sizeof(float) * 3);
+	Mix(h, &b.duration, sizeof(b.duration));
+}
+
+uint64_t DuelSim::hash(const Player& opponent) const {
+	// field by field, so padding never gets in
+	unsigned char flags[13] = { gameStart, pickedUp, fire, fired, finishFire, dead, wins, handOnGun,
+		opponent.fire, opponent.fired, opponent.pickedUp, opponent.finishFire, opponent.dead };
+	uint64_t h = 14695981039346656037ull;
+	Mix(h, flags, sizeof(flags));
+	Mix(h, &gunBox[0].x, sizeof(float) * 16);
+	Mix(h, &handBox[0].x, sizeof(float) * 16);
+	MixBullet(h, bullet);
+	MixBullet(h, otherBullet);
+	return h;
+}
+
+SimBullet Interpolate(const SimBullet& from, const SimBullet& to, float alpha) {
+	if (to.duration > from.duration)
+		return to;
+	SimBullet b = to;
+	// the bullet only ever translates, so blending the matrices is exact
+	for (int c = 0; c < 4; c++)
+		b.toWorld[c] = from.toWorld[c] + (to.toWorld[c] - from.toWorld[c]) * alpha;
+	return b;
+}
+
+DuelInput ReplayInput(const ReplayTick& tick, int seat, double startAt) {
+	const Player& self = tick.players[seat];
+	DuelInput in;
+	in.clockSynced = true;
+	in.now = tick.time;
+	in.startAt = startAt;
+	in.headPos = self.headPos;
+	in.handPos = self.handpos;
+	in.handRotation = glm::mat4_cast(self.handrotation);
+	in.shootDir = self.shootDir;
+	in.grip = self.pickedUp;
+	in.opponentHit = tick.died[1 - seat];
+	in.localHit = tick.died[seat];
+	return in;
+}
@@ -0,0 +1,99 @@
+#ifndef DUELSIM_H
+#define DUELSIM_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Shared struct
+#include "Aabb.h"
+#include "Obb.h"
+#include "Player.h"
+#include "Replay.h"
+
+// One frame of what the client saw: its own tracking, the match clock and the
+// server's hit events. Everything the duel rules read comes in through here.
+struct DuelInput {
+	bool clockSynced;
+	double now;     // server match clock
+	double startAt; // when the duel starts on it, 0 until known
+	glm::vec3 headPos;
+	glm::vec3 handPos;
+	glm::mat4 handRotation;
+	glm::vec3 shootDir;
+	bool grip; // right hand trigger held
+	bool opponentHit;
+	bool localHit;
+};
+
+// What a step did, for the client to play sounds and talk to the server
+enum DuelEvent {
+	DUEL_SHOT = 1,   // a shot to hand to the server
+	DUEL_FIRING = 2, // a bullet is in flight
+	DUEL_WON = 4,
+	DUEL_LOST = 8,
+};
+
+struct SimBullet {
+	glm::mat4 toWorld;
+	glm::vec3 viewdir;
+	int duration; // steps left in flight
+};
+
+// The gameplay of a duel without any GL: picking up the gun, the bullets' flight
+// and countdown, and winning or losing. The client steps it STEP_RATE times a
+// second, whatever its frame rate, and draws what it holds; the benchmark steps
+// it from a recorded trace as fast as it goes. The same inputs always give the same state, see hash().
+class DuelSim {
+public:
+	// the rules count in steps; they were tuned at two steps a frame on a 90 Hz headset
+	static const int STEP_RATE = 180;
+	static const int BULLET_LIFE = 400; // ~2.2 s
+
+	DuelSim() { reset(); }
+
+	void reset();
+	// the extreme vertices of the gun's and the hand's models (Model::boxVertices)
+	void setBoxes(const std::vector<glm::vec3>& gun, const std::vector<glm::vec3>& hand);
+
+	// the index trigger; only fires once the duel is on and the gun is in hand
+	void pullTrigger();
+
+	// Advances the duel by one step and returns the DuelEvent bits it raised.
+	// The opponent's flags are read and updated in place.
+	unsigned step(const DuelInput& in, Player& opponent);
+
+	// FNV-1a over the state and the opponent's flags
+	uint64_t hash(const Player& opponent) const;
+
+	bool gameStart;
+	bool pickedUp;
+	bool fire;
+	bool fired;
+	bool finishFire;
+	bool dead;
+	bool wins;
+	bool handOnGun;    // as of the last grip
+	glm::mat4 gunBox;  // world transforms of the pickup boxes
+	glm::mat4 handBox;
+	SimBullet bullet;
+	SimBullet otherBullet;
+
+private:
+	void localStep(const DuelInput& in, Player& opponent, unsigned& events);
+	void opponentStep(Player& opponent, unsigned& events);
+
+	Aabb gunLocal;
+	Aabb handLocal;
+};
+
+// A bullet as drawn a fraction alpha of the way from one step to the next. A
+// bullet that went back to the hand in between is not swept back across the room.
+SimBullet Interpolate(const SimBullet& from, const SimBullet& to, float alpha);
+
+// A recorded server tick as the client in the given seat would have seen it.
+// The recording has no grip, so holding the gun stands in for it.
+DuelInput ReplayInput(const ReplayTick& tick, int seat, double startAt);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef FIXEDSTEP_H
+#define FIXEDSTEP_H
+
+// Runs a simulation at a fixed rate whatever rate the frames come at. Each
+// frame adds the time since the last one and gets back how many whole steps
+// are due; the part of a step left over is alpha(), for drawing between the
+// last two states. A hitch longer than maxSteps is dropped rather than
+// caught up, so one slow frame cannot snowball into the next.
+class FixedStep {
+public:
+	FixedStep(double step, int maxSteps) : step(step), maxSteps(maxSteps) { reset(); }
+
+	void reset() {
+		last = 0.0;
+		started = false;
+		accumulated = 0.0;
+		skipped = 0;
+	}
+
+	// now in seconds on a steady clock; returns the steps to run this frame
+	int advance(double now) {
+		if (!started) {
+			started = true;
+			last = now;
+			return 0;
+		}
+		if (now > last)
+			accumulated += now - last;
+		last = now;
+		int due = (int)(accumulated / step);
+		accumulated -= due * step;
+		if (due > maxSteps) {
+			skipped += due - maxSteps;
+			due = maxSteps;
+		}
+		return due;
+	}
+
+	// how far into the next step the frame is, 0 to 1
+	float alpha() const { return (float)(accumulated / step); }
+	double seconds() const { return step; }
+	// steps given up to hitches
+	unsigned long long dropped() const { return skipped; }
+
+private:
+	double step;
+	int maxSteps;
+	double last;
+	bool started;
+	double accumulated;
+	unsigned long long skipped;
+};
+
+#endif
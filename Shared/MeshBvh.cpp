@@ -0,0 +1,232 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const int BINS = 16;          // split planes tried per axis
+static const int MAX_DEPTH = 60;     // below the query stack's 64
+static const float MISS = 1e30f;
+
+static float Area(const Aabb& box) {
+	glm::vec3 d = box.hi - box.lo;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static Aabb Empty() {
+	return { glm::vec3(MISS), glm::vec3(-MISS) };
+}
+
+static void Grow(Aabb& box, const Aabb& other) {
+	box.lo = glm::min(box.lo, other.lo);
+	box.hi = glm::max(box.hi, other.hi);
+}
+
+// where the ray enters the box, or MISS if it does not before best
+static inline float Enter(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& origin, const glm::vec3& inv, float best) {
+	float tx1 = (lo.x - origin.x) * inv.x, tx2 = (hi.x - origin.x) * inv.x;
+	float enter = std::min(tx1, tx2), leave = std::max(tx1, tx2);
+	float ty1 = (lo.y - origin.y) * inv.y, ty2 = (hi.y - origin.y) * inv.y;
+	enter = std::max(enter, std::min(ty1, ty2));
+	leave = std::min(leave, std::max(ty1, ty2));
+	float tz1 = (lo.z - origin.z) * inv.z, tz2 = (hi.z - origin.z) * inv.z;
+	enter = std::max(enter, std::min(tz1, tz2));
+	leave = std::min(leave, std::max(tz1, tz2));
+	return leave >= enter && enter < best && leave >= 0.0f ? enter : MISS;
+}
+
+void MeshBvh::build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
+	nodes.clear();
+	triangles.clear();
+	ids.clear();
+	uint32_t count = (uint32_t)(indices.size() / 3);
+	if (count == 0)
+		return;
+
+	std::vector<Aabb> boxes(count);
+	std::vector<glm::vec3> centres(count);
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const glm::vec3& a = positions[indices[3 * i]];
+		const glm::vec3& b = positions[indices[3 * i + 1]];
+		const glm::vec3& c = positions[indices[3 * i + 2]];
+		boxes[i] = { glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)) };
+		centres[i] = (boxes[i].lo + boxes[i].hi) * 0.5f;
+		order[i] = i;
+	}
+
+	nodes.reserve(2 * count - 1);
+	nodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), count });
+	subdivide(0, 0, order, boxes, centres);
+
+	triangles.reserve(count);
+	ids = order;
+	for (uint32_t i : order) {
+		const glm::vec3& a = positions[indices[3 * i]];
+		triangles.push_back({ a, positions[indices[3 * i + 1]] - a, positions[indices[3 * i + 2]] - a });
+	}
+}
+
+// Splits a node where the children's triangle counts weighted by their areas
+// come out lowest, trying the planes between BINS bins of triangle centres on
+// each axis; a node no split makes cheaper stays a leaf
+void MeshBvh::subdivide(uint32_t index, int depth, std::vector<uint32_t>& order, const std::vector<Aabb>& boxes, const std::vector<glm::vec3>& centres) {
+	uint32_t first = nodes[index].first, count = nodes[index].count;
+	Aabb box = Empty();
+	Aabb centreBox = Empty();
+	for (uint32_t i = first; i < first + count; i++) {
+		Grow(box, boxes[order[i]]);
+		Grow(centreBox, { centres[order[i]], centres[order[i]] });
+	}
+	nodes[index].lo = box.lo;
+	nodes[index].hi = box.hi;
+	if (count <= 2 || depth >= MAX_DEPTH)
+		return;
+
+	float bestCost = count * Area(box);
+	int bestAxis = -1, bestPlane = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centreBox.hi[axis] - centreBox.lo[axis];
+		if (extent <= 0.0f)
+			continue;
+		float scale = BINS / extent;
+		Aabb binBox[BINS];
+		uint32_t binCount[BINS] = {};
+		for (int b = 0; b < BINS; b++)
+			binBox[b] = Empty();
+		for (uint32_t i = first; i < first + count; i++) {
+			int b = std::min(BINS - 1, (int)((centres[order[i]][axis] - centreBox.lo[axis]) * scale));
+			binCount[b]++;
+			Grow(binBox[b], boxes[order[i]]);
+		}
+		// plane p splits bins [0, p] from [p + 1, BINS)
+		float leftArea[BINS - 1], rightArea[BINS - 1];
+		uint32_t leftCount[BINS - 1], rightCount[BINS - 1];
+		Aabb left = Empty(), right = Empty();
+		uint32_t leftSum = 0, rightSum = 0;
+		for (int p = 0; p < BINS - 1; p++) {
+			leftSum += binCount[p];
+			Grow(left, binBox[p]);
+			leftCount[p] = leftSum;
+			leftArea[p] = leftSum ? Area(left) : 0.0f;
+			rightSum += binCount[BINS - 1 - p];
+			Grow(right, binBox[BINS - 1 - p]);
+			rightCount[BINS - 2 - p] = rightSum;
+			rightArea[BINS - 2 - p] = rightSum ? Area(right) : 0.0f;
+		}
+		for (int p = 0; p < BINS - 1; p++) {
+			if (!leftCount[p] || !rightCount[p])
+				continue;
+			float cost = leftCount[p] * leftArea[p] + rightCount[p] * rightArea[p];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestPlane = p;
+			}
+		}
+	}
+	if (bestAxis < 0)
+		return;
+
+	float scale = BINS / (centreBox.hi[bestAxis] - centreBox.lo[bestAxis]);
+	uint32_t i = first, j = first + count;
+	while (i < j) {
+		int b = std::min(BINS - 1, (int)((centres[order[i]][bestAxis] - centreBox.lo[bestAxis]) * scale));
+		if (b <= bestPlane)
+			i++;
+		else
+			std::swap(order[i], order[--j]);
+	}
+	uint32_t leftCount = i - first;
+	if (leftCount == 0 || leftCount == count)
+		return;
+
+	uint32_t left = (uint32_t)nodes.size();
+	nodes.push_back({ glm::vec3(0.0f), first, glm::vec3(0.0f), leftCount });
+	nodes.push_back({ glm::vec3(0.0f), i, glm::vec3(0.0f), count - leftCount });
+	nodes[index].first = left;
+	nodes[index].count = 0;
+	subdivide(left, depth + 1, order, boxes, centres);
+	subdivide(left + 1, depth + 1, order, boxes, centres);
+}
+
+Aabb MeshBvh::bounds() const {
+	if (nodes.empty())
+		return { glm::vec3(0.0f), glm::vec3(0.0f) };
+	return { nodes[0].lo, nodes[0].hi };
+}
+
+// Nearer child first, the other one kept on a stack for when the near side is
+// done; double sided, since a bullet can come from anywhere
+bool MeshBvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float maxT, MeshHit& hit) const {
+	if (nodes.empty())
+		return false;
+	glm::vec3 inv(SlabInverse(dir.x), SlabInverse(dir.y), SlabInverse(dir.z));
+	float best = maxT;
+	uint32_t found = UINT32_MAX;
+	if (Enter(nodes[0].lo, nodes[0].hi, origin, inv, best) == MISS)
+		return false;
+
+	uint32_t stack[64];
+	int top = 0;
+	uint32_t index = 0;
+	for (;;) {
+		const Node& n = nodes[index];
+		if (n.count) {
+			for (uint32_t i = n.first; i < n.first + n.count; i++) {
+				// Moller-Trumbore
+				const Triangle& tri = triangles[i];
+				glm::vec3 p = glm::cross(dir, tri.e2);
+				float det = glm::dot(tri.e1, p);
+				if (std::fabs(det) < 1e-12f)
+					continue;
+				float invDet = 1.0f / det;
+				glm::vec3 s = origin - tri.v0;
+				float u = glm::dot(s, p) * invDet;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+				glm::vec3 q = glm::cross(s, tri.e1);
+				float v = glm::dot(dir, q) * invDet;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+				float t = glm::dot(tri.e2, q) * invDet;
+				if (t >= 0.0f && t <= best) {
+					best = t;
+					found = i;
+				}
+			}
+			if (top == 0)
+				break;
+			index = stack[--top];
+			continue;
+		}
+		uint32_t nearChild = n.first, farChild = n.first + 1;
+		float nearT = Enter(nodes[nearChild].lo, nodes[nearChild].hi, origin, inv, best);
+		float farT = Enter(nodes[farChild].lo, nodes[farChild].hi, origin, inv, best);
+		if (farT < nearT) {
+			std::swap(nearChild, farChild);
+			std::swap(nearT, farT);
+		}
+		if (nearT == MISS) {
+			if (top == 0)
+				break;
+			index = stack[--top];
+			continue;
+		}
+		index = nearChild;
+		if (farT != MISS)
+			stack[top++] = farChild;
+	}
+	if (found == UINT32_MAX)
+		return false;
+	hit.triangle = ids[found];
+	hit.t = best;
+	return true;
+}
+
+bool MeshBvh::segment(const glm::vec3& from, const glm::vec3& to, float& toi) const {
+	MeshHit hit;
+	if (!raycast(from, to - from, 1.0f, hit))
+		return false;
+	toi = hit.t;
+	return true;
+}
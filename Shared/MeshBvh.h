@@ -0,0 +1,58 @@
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Aabb.h"
+
+struct MeshHit {
+	uint32_t triangle; // as numbered in the indices the tree was built from
+	float t;
+};
+
+// A bounding volume hierarchy over a model's triangles, built once at load
+// time with the surface area heuristic, for hit tests against the mesh itself
+// rather than the box around it. Nodes are 32 bytes with both children next to
+// each other, and the triangles are stored in leaf order, so a query walks
+// through memory mostly forward.
+class MeshBvh {
+public:
+	// three indices per triangle into positions, as Model keeps them
+	void build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+
+	// the closest triangle along origin + t * dir, for t in [0, maxT]; dir need not be unit length
+	bool raycast(const glm::vec3& origin, const glm::vec3& dir, float maxT, MeshHit& hit) const;
+	// the first point of from -> to on the mesh, toi as in SweepBox
+	bool segment(const glm::vec3& from, const glm::vec3& to, float& toi) const;
+
+	bool empty() const { return nodes.empty(); }
+	Aabb bounds() const;
+	size_t triangleCount() const { return triangles.size(); }
+	size_t nodeCount() const { return nodes.size(); }
+
+private:
+	struct Node {
+		glm::vec3 lo;
+		uint32_t first; // leaves: first triangle; branches: left child, right child after it
+		glm::vec3 hi;
+		uint32_t count; // triangles in a leaf, 0 on branches
+	};
+	// a corner and the two edges from it, which is what the hit test wants
+	struct Triangle {
+		glm::vec3 v0;
+		glm::vec3 e1;
+		glm::vec3 e2;
+	};
+
+	void subdivide(uint32_t node, int depth, std::vector<uint32_t>& order, const std::vector<Aabb>& boxes, const std::vector<glm::vec3>& centres);
+
+	std::vector<Node> nodes;
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> ids; // triangles[i] is ids[i] in the indices
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "Obb.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OBB_SSE 1
+#include <emmintrin.h>
+#endif
+
+// keeps the cross product axes of two nearly parallel edges from being taken
+// as separating when they are really (almost) zero
+static const float PARALLEL = 1e-6f;
+
+Obb OrientedBox(const glm::mat4& toWorld, const Aabb& local) {
+	glm::vec3 centre = (local.lo + local.hi) * 0.5f;
+	glm::vec3 half = (local.hi - local.lo) * 0.5f;
+	Obb box;
+	box.centre = glm::vec3(toWorld[3]) + glm::vec3(toWorld[0]) * centre.x + glm::vec3(toWorld[1]) * centre.y + glm::vec3(toWorld[2]) * centre.z;
+	for (int i = 0; i < 3; i++) {
+		glm::vec3 column(toWorld[i]);
+		float length = std::sqrt(glm::dot(column, column));
+		glm::vec3 unit(0.0f);
+		unit[i] = 1.0f;
+		box.axis[i] = length > 0.0f ? column / length : unit;
+		box.half[i] = half[i] * length;
+	}
+	return box;
+}
+
+// Gottschalk's test as Ericson writes it: b in a's frame, then a's three
+// axes, b's three and the nine cross products of one of each
+bool ObbOverlapScalar(const Obb& a, const Obb& b) {
+	float R[3][3], AbsR[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			R[i][j] = glm::dot(a.axis[i], b.axis[j]);
+			AbsR[i][j] = std::fabs(R[i][j]) + PARALLEL;
+		}
+	}
+	glm::vec3 d = b.centre - a.centre;
+	float t[3] = { glm::dot(d, a.axis[0]), glm::dot(d, a.axis[1]), glm::dot(d, a.axis[2]) };
+
+	for (int i = 0; i < 3; i++) {
+		float rb = b.half[0] * AbsR[i][0] + b.half[1] * AbsR[i][1] + b.half[2] * AbsR[i][2];
+		if (std::fabs(t[i]) > a.half[i] + rb)
+			return false;
+	}
+	for (int j = 0; j < 3; j++) {
+		float ra = a.half[0] * AbsR[0][j] + a.half[1] * AbsR[1][j] + a.half[2] * AbsR[2][j];
+		if (std::fabs(t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j]) > ra + b.half[j])
+			return false;
+	}
+	for (int i = 0; i < 3; i++) {
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; j++) {
+			int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			float ra = a.half[i1] * AbsR[i2][j] + a.half[i2] * AbsR[i1][j];
+			float rb = b.half[j1] * AbsR[i][j2] + b.half[j2] * AbsR[i][j1];
+			if (std::fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb)
+				return false;
+		}
+	}
+	return true;
+}
+
+#ifdef OBB_SSE
+static inline __m128 Abs(__m128 v) {
+	return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+static inline __m128 Lanes(const glm::vec3& v) {
+	return _mm_setr_ps(v.x, v.y, v.z, 0.0f);
+}
+
+// The same sums in the same order, with b's three axes in the lanes: row i of
+// R holds a's axis i against each of b's
+bool ObbOverlap(const Obb& a, const Obb& b) {
+	const __m128 parallel = _mm_setr_ps(PARALLEL, PARALLEL, PARALLEL, 0.0f);
+	__m128 bx = _mm_setr_ps(b.axis[0].x, b.axis[1].x, b.axis[2].x, 0.0f);
+	__m128 by = _mm_setr_ps(b.axis[0].y, b.axis[1].y, b.axis[2].y, 0.0f);
+	__m128 bz = _mm_setr_ps(b.axis[0].z, b.axis[1].z, b.axis[2].z, 0.0f);
+	__m128 row[3], absRow[3];
+	for (int i = 0; i < 3; i++) {
+		row[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.axis[i].x), bx), _mm_mul_ps(_mm_set1_ps(a.axis[i].y), by)),
+			_mm_mul_ps(_mm_set1_ps(a.axis[i].z), bz));
+		absRow[i] = _mm_add_ps(Abs(row[i]), parallel);
+	}
+	glm::vec3 d = b.centre - a.centre;
+	float t[3] = { glm::dot(d, a.axis[0]), glm::dot(d, a.axis[1]), glm::dot(d, a.axis[2]) };
+	__m128 aHalf = Lanes(a.half), bHalf = Lanes(b.half);
+
+	// a's axes, one per lane, from R's columns
+	__m128 col0 = absRow[0], col1 = absRow[1], col2 = absRow[2], col3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+	__m128 rb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(b.half.x), col0), _mm_mul_ps(_mm_set1_ps(b.half.y), col1)),
+		_mm_mul_ps(_mm_set1_ps(b.half.z), col2));
+	__m128 apart = _mm_cmpgt_ps(Abs(_mm_setr_ps(t[0], t[1], t[2], 0.0f)), _mm_add_ps(aHalf, rb));
+	// b's axes
+	__m128 ra = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.half.x), absRow[0]), _mm_mul_ps(_mm_set1_ps(a.half.y), absRow[1])),
+		_mm_mul_ps(_mm_set1_ps(a.half.z), absRow[2]));
+	__m128 tb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t[0]), row[0]), _mm_mul_ps(_mm_set1_ps(t[1]), row[1])),
+		_mm_mul_ps(_mm_set1_ps(t[2]), row[2]));
+	apart = _mm_or_ps(apart, _mm_cmpgt_ps(Abs(tb), _mm_add_ps(ra, bHalf)));
+	if (_mm_movemask_ps(apart) & 7)
+		return false;
+
+	// a's axis i crossed with each of b's; lanes j + 1 and j + 2 by shuffling
+	__m128 bHalf1 = _mm_shuffle_ps(bHalf, bHalf, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 bHalf2 = _mm_shuffle_ps(bHalf, bHalf, _MM_SHUFFLE(3, 1, 0, 2));
+	for (int i = 0; i < 3; i++) {
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		ra = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.half[i1]), absRow[i2]), _mm_mul_ps(_mm_set1_ps(a.half[i2]), absRow[i1]));
+		__m128 abs1 = _mm_shuffle_ps(absRow[i], absRow[i], _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 abs2 = _mm_shuffle_ps(absRow[i], absRow[i], _MM_SHUFFLE(3, 1, 0, 2));
+		rb = _mm_add_ps(_mm_mul_ps(bHalf1, abs2), _mm_mul_ps(bHalf2, abs1));
+		__m128 tc = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(t[i2]), row[i1]), _mm_mul_ps(_mm_set1_ps(t[i1]), row[i2]));
+		apart = _mm_or_ps(apart, _mm_cmpgt_ps(Abs(tc), _mm_add_ps(ra, rb)));
+	}
+	return (_mm_movemask_ps(apart) & 7) == 0;
+}
+#else
+bool ObbOverlap(const Obb& a, const Obb& b) {
+	return ObbOverlapScalar(a, b);
+}
+#endif
+
+// A slab test in the box's own frame
+bool ObbRay(const Obb& box, const glm::vec3& origin, const glm::vec3& dir, float maxT, float& t) {
+	glm::vec3 p = origin - box.centre;
+	float enter = 0.0f;
+	float leave = maxT;
+	for (int i = 0; i < 3; i++) {
+		float o = glm::dot(p, box.axis[i]);
+		float d = glm::dot(dir, box.axis[i]);
+		if (std::fabs(d) < 1e-30f) {
+			if (o < -box.half[i] || o > box.half[i])
+				return false;
+			continue;
+		}
+		float t1 = (-box.half[i] - o) / d;
+		float t2 = (box.half[i] - o) / d;
+		enter = std::max(enter, std::min(t1, t2));
+		leave = std::min(leave, std::max(t1, t2));
+		if (enter > leave)
+			return false;
+	}
+	t = enter;
+	return true;
+}
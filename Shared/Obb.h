@@ -0,0 +1,28 @@
+#ifndef OBB_H
+#define OBB_H
+
+#include <glm/glm.hpp>
+
+#include "Aabb.h"
+
+// A box turned with its model: the axes are the model's, so a rotated head or
+// gun keeps a tight box where its world Aabb grows. Tests between two of them
+// go over the 15 separating axes of two boxes; Aabbs stay the broad phase.
+struct Obb {
+	glm::vec3 centre;
+	glm::vec3 axis[3];   // unit length
+	glm::vec3 half;      // extent along each axis
+};
+
+// The local box under toWorld, which may scale but not shear
+Obb OrientedBox(const glm::mat4& toWorld, const Aabb& local);
+
+// Whether two boxes overlap; touching counts
+bool ObbOverlap(const Obb& a, const Obb& b);
+// the textbook one axis at a time, which ObbOverlap gives the same answers as
+bool ObbOverlapScalar(const Obb& a, const Obb& b);
+
+// where origin + t * dir first meets the box for t in [0, maxT]; a ray starting inside hits at 0
+bool ObbRay(const Obb& box, const glm::vec3& origin, const glm::vec3& dir, float maxT, float& t);
+
+#endif
@@ -0,0 +1,59 @@
+#include "ObjMesh.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+bool ReadObj(const char* path, std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices) {
+	std::ifstream in(path);
+	if (!in)
+		return false;
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream words(line);
+		std::string kind;
+		words >> kind;
+		if (kind == "v") {
+			glm::vec3 p;
+			if (!(words >> p.x >> p.y >> p.z))
+				return false;
+			positions.push_back(p);
+		}
+		else if (kind == "f") {
+			std::vector<unsigned int> face;
+			std::string corner;
+			while (words >> corner) {
+				// the position index before any '/', 1-based or counted back from the last vertex
+				const char* text = corner.c_str();
+				char* end;
+				long i = std::strtol(text, &end, 10);
+				if (end == text || (*end != '\0' && *end != '/'))
+					return false;
+				long index = i < 0 ? (long)positions.size() + i : i - 1;
+				if (i == 0 || index < 0 || index >= (long)positions.size())
+					return false;
+				face.push_back((unsigned int)index);
+			}
+			for (size_t k = 2; k < face.size(); k++) {
+				indices.push_back(face[0]);
+				indices.push_back(face[k - 1]);
+				indices.push_back(face[k]);
+			}
+		}
+	}
+	return true;
+}
+
+void UnitScale(std::vector<glm::vec3>& positions) {
+	glm::vec3 lo(1e30f), hi(-1e30f);
+	for (const glm::vec3& p : positions) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	glm::vec3 size = hi - lo;
+	float largest = std::max(size.x, std::max(size.y, size.z));
+	for (glm::vec3& p : positions)
+		p = (p - (lo + hi) * 0.5f) / largest;
+}
@@ -0,0 +1,17 @@
+#ifndef OBJMESH_H
+#define OBJMESH_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// The positions and faces of an OBJ, faces split into fans: enough for a hit
+// test mesh (MeshBvh.h) where there is no assimp, on the server and in the
+// benchmarks. False if the file cannot be opened or is malformed, e.g. a face
+// refers to a vertex not defined before it.
+bool ReadObj(const char* path, std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices);
+
+// Model::scaleProcess: centred, with the largest side 1
+void UnitScale(std::vector<glm::vec3>& positions);
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef PLAYERCODEC_H
+#define PLAYERCODEC_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Shared struct
+#include "Player.h"
+#include "Protocol.h"
+
+// Compact fixed-layout encoding of Player, used instead of MSGPACK_DEFINE_MAP on
+// the per-frame path. No field names go on the wire:
+//   1 byte   flags (fire, fired, pickedUp, finishFire, dead)
+//   3 x 4    rotation, handrotation, headrotation as smallest-three quaternions
+//   2 x 6    handpos, headPos as 16 bit millimetres (+-32 m)
+//   2 x 6    viewDir, shootDir as 16 bit fixed point (+-4, 1/8192 steps)
+// 37 bytes in total, all multi-byte values little endian.
+
+typedef std::vector<unsigned char> Packet;
+
+const size_t PACKED_PLAYER_SIZE = 37;
+
+namespace codec
+{
+	const float POSITION_SCALE = 1000.0f;
+	const float DIRECTION_SCALE = 8192.0f;
+	const float QUAT_RANGE = 0.70710678f; // largest possible value of a non-largest component
+
+	inline void put16(unsigned char*& out, uint16_t v) {
+		*out++ = (unsigned char)v;
+		*out++ = (unsigned char)(v >> 8);
+	}
+
+	inline void put32(unsigned char*& out, uint32_t v) {
+		put16(out, (uint16_t)v);
+		put16(out, (uint16_t)(v >> 16));
+	}
+
+	inline uint16_t get16(const unsigned char*& in) {
+		uint16_t v = (uint16_t)(in[0] | (in[1] << 8));
+		in += 2;
+		return v;
+	}
+
+	inline uint32_t get32(const unsigned char*& in) {
+		uint32_t lo = get16(in);
+		return lo | ((uint32_t)get16(in) << 16);
+	}
+
+	inline int16_t quantize(float v, float scale) {
+		float q = std::round(v * scale);
+		return (int16_t)std::max(-32767.0f, std::min(32767.0f, q));
+	}
+
+	inline void putVec3(unsigned char*& out, const glm::vec3& v, float scale) {
+		put16(out, (uint16_t)quantize(v.x, scale));
+		put16(out, (uint16_t)quantize(v.y, scale));
+		put16(out, (uint16_t)quantize(v.z, scale));
+	}
+
+	inline glm::vec3 getVec3(const unsigned char*& in, float scale) {
+		float x = (int16_t)get16(in) / scale;
+		float y = (int16_t)get16(in) / scale;
+		float z = (int16_t)get16(in) / scale;
+		return glm::vec3(x, y, z);
+	}
+
+	// 2 bits index of the dropped (largest) component, 3 x 10 bits for the others.
+	// The sign is flipped so the dropped component is positive; q and -q are the same rotation.
+	inline uint32_t packQuat(const glm::quat& q) {
+		float c[4] = { q.x, q.y, q.z, q.w };
+		float len = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2] + c[3] * c[3]);
+		if (len < 1e-6f)
+			return 3u << 30; // degenerate: identity
+		int largest = 0;
+		for (int i = 1; i < 4; i++) {
+			if (std::fabs(c[i]) > std::fabs(c[largest]))
+				largest = i;
+		}
+		float sign = c[largest] < 0 ? -1.0f : 1.0f;
+		uint32_t bits = (uint32_t)largest << 30;
+		int shift = 20;
+		for (int i = 0; i < 4; i++) {
+			if (i == largest)
+				continue;
+			float v = sign * c[i] / len / QUAT_RANGE; // -1..1
+			uint32_t u = (uint32_t)std::round((std::max(-1.0f, std::min(1.0f, v)) + 1.0f) * 511.5f);
+			bits |= u << shift;
+			shift -= 10;
+		}
+		return bits;
+	}
+
+	inline glm::quat unpackQuat(uint32_t bits) {
+		int largest = bits >> 30;
+		float c[4];
+		float sum = 0.0f;
+		int shift = 20;
+		for (int i = 0; i < 4; i++) {
+			if (i == largest)
+				continue;
+			c[i] = (((bits >> shift) & 1023) / 511.5f - 1.0f) * QUAT_RANGE;
+			sum += c[i] * c[i];
+			shift -= 10;
+		}
+		c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+		glm::quat q;
+		q.x = c[0];
+		q.y = c[1];
+		q.z = c[2];
+		q.w = c[3];
+		return q;
+	}
+}
+
+// writes exactly PACKED_PLAYER_SIZE bytes
+inline void PackPlayer(const Player& p, unsigned char* out) {
+	*out++ = (unsigned char)((p.fire ? 1 : 0) | (p.fired ? 2 : 0) | (p.pickedUp ? 4 : 0) | (p.finishFire ? 8 : 0) | (p.dead ? 16 : 0));
+	codec::put32(out, codec::packQuat(p.rotation));
+	codec::put32(out, codec::packQuat(p.handrotation));
+	codec::put32(out, codec::packQuat(p.headrotation));
+	codec::putVec3(out, p.handpos, codec::POSITION_SCALE);
+	codec::putVec3(out, p.headPos, codec::POSITION_SCALE);
+	codec::putVec3(out, p.viewDir, codec::DIRECTION_SCALE);
+	codec::putVec3(out, p.shootDir, codec::DIRECTION_SCALE);
+}
+
+// reads exactly PACKED_PLAYER_SIZE bytes
+inline void UnpackPlayer(const unsigned char* in, Player& p) {
+	unsigned char flags = *in++;
+	p.fire = (flags & 1) != 0;
+	p.fired = (flags & 2) != 0;
+	p.pickedUp = (flags & 4) != 0;
+	p.finishFire = (flags & 8) != 0;
+	p.dead = (flags & 16) != 0;
+	p.rotation = codec::unpackQuat(codec::get32(in));
+	p.handrotation = codec::unpackQuat(codec::get32(in));
+	p.headrotation = codec::unpackQuat(codec::get32(in));
+	p.handpos = codec::getVec3(in, codec::POSITION_SCALE);
+	p.headPos = codec::getVec3(in, codec::POSITION_SCALE);
+	p.viewDir = codec::getVec3(in, codec::DIRECTION_SCALE);
+	p.shootDir = codec::getVec3(in, codec::DIRECTION_SCALE);
+}
+
+// "sync_packed" request: packed player, u32 last tick seen
+inline Packet PackSyncRequest(const Player& p, uint64_t lastTick) {
+	Packet packet(PACKED_PLAYER_SIZE + 4);
+	PackPlayer(p, &packet[0]);
+	unsigned char* out = &packet[PACKED_PLAYER_SIZE];
+	codec::put32(out, (uint32_t)lastTick);
+	return packet;
+}
+
+inline bool UnpackSyncRequest(const Packet& packet, Player& p, uint64_t& lastTick) {
+	if (packet.size() < PACKED_PLAYER_SIZE + 4)
+		return false;
+	UnpackPlayer(&packet[0], p);
+	const unsigned char* in = &packet[PACKED_PLAYER_SIZE];
+	lastTick = codec::get32(in);
+	return true;
+}
+
+// "sync_packed" reply: u32 tick, f32 time, u8 opponent, packed player,
+// u8 event count, then u8 type + u32 tick per event
+inline Packet PackSyncReply(const SyncReply& reply) {
+	size_t events = std::min<size_t>(reply.events.size(), 255);
+	Packet packet(4 + 4 + 1 + PACKED_PLAYER_SIZE + 1 + events * 5);
+	unsigned char* out = &packet[0];
+	codec::put32(out, (uint32_t)reply.tick);
+	float time = (float)reply.time;
+	uint32_t timeBits;
+	std::memcpy(&timeBits, &time, 4);
+	codec::put32(out, timeBits);
+	*out++ = reply.opponent ? 1 : 0;
+	PackPlayer(reply.other, out);
+	out += PACKED_PLAYER_SIZE;
+	*out++ = (unsigned char)events;
+	for (size_t i = 0; i < events; i++) {
+		*out++ = (unsigned char)reply.events[i].type;
+		codec::put32(out, (uint32_t)reply.events[i].tick);
+	}
+	return packet;
+}
+
+inline bool UnpackSyncReply(const Packet& packet, SyncReply& reply) {
+	const size_t fixed = 4 + 4 + 1 + PACKED_PLAYER_SIZE + 1;
+	if (packet.size() < fixed)
+		return false;
+	const unsigned char* in = &packet[0];
+	reply.tick = codec::get32(in);
+	uint32_t timeBits = codec::get32(in);
+	float time;
+	std::memcpy(&time, &timeBits, 4);
+	reply.time = time;
+	reply.opponent = *in++ != 0;
+	UnpackPlayer(in, reply.other);
+	in += PACKED_PLAYER_SIZE;
+	size_t events = *in++;
+	if (packet.size() < fixed + events * 5)
+		return false;
+	reply.events.resize(events);
+	for (size_t i = 0; i < events; i++) {
+		reply.events[i].type = *in++;
+		reply.events[i].tick = codec::get32(in);
+	}
+	return true;
+}
+
+#endif
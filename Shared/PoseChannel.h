@@ -0,0 +1,81 @@
+#ifndef POSECHANNEL_H
+#define POSECHANNEL_H
+
+#include <cstdint>
+
+#include "PlayerCodec.h"
+#include "SnapshotDelta.h"
+
+// Unreliable pose channel that runs next to the rpc connection. Poses and
+// opponent snapshots go over UDP so a lost datagram only costs that datagram;
+// events (fire, death, match start) stay on the reliable rpc side.
+//
+// The client gets a ticket from the "udp_token" rpc and tags every datagram
+// with its token, which ties the datagram to its rpc session.
+//   pose      client -> server   u8 POSE_DATAGRAM, u32 token, u32 seq,
+//                                u32 ack tick, u32 input seq, packed player
+//   snapshot  server -> client   u8 SNAPSHOT_DATAGRAM, u32 seq being answered,
+//                                "sync_delta" reply without events
+// Both sides drop anything older than what they already have: the server by
+// seq per token, the client by snapshot tick.
+
+enum DatagramType {
+	POSE_DATAGRAM = 1,
+	SNAPSHOT_DATAGRAM = 2
+};
+
+const size_t POSE_DATAGRAM_SIZE = 1 + 4 + 4 + 4 + 4 + PACKED_PLAYER_SIZE;
+const size_t MAX_DATAGRAM_SIZE = 512;
+
+struct PoseDatagram {
+	uint32_t token;
+	uint32_t seq;
+	uint32_t ackTick;
+	uint32_t inputSeq; // frame the player belongs to (Prediction.h); seq only orders datagrams
+	Player player;
+};
+
+inline size_t PackPoseDatagram(const PoseDatagram& d, unsigned char* out) {
+	unsigned char* begin = out;
+	*out++ = POSE_DATAGRAM;
+	codec::put32(out, d.token);
+	codec::put32(out, d.seq);
+	codec::put32(out, d.ackTick);
+	codec::put32(out, d.inputSeq);
+	PackPlayer(d.player, out);
+	return out - begin + PACKED_PLAYER_SIZE;
+}
+
+inline bool UnpackPoseDatagram(const unsigned char* in, size_t size, PoseDatagram& d) {
+	if (size < POSE_DATAGRAM_SIZE || in[0] != POSE_DATAGRAM)
+		return false;
+	in++;
+	d.token = codec::get32(in);
+	d.seq = codec::get32(in);
+	d.ackTick = codec::get32(in);
+	d.inputSeq = codec::get32(in);
+	UnpackPlayer(in, d.player);
+	return true;
+}
+
+// seq of the pose being answered, followed by the delta reply
+inline size_t PackSnapshotDatagram(uint32_t seq, const Packet& reply, unsigned char* out, size_t capacity) {
+	if (1 + 4 + reply.size() > capacity)
+		return 0;
+	unsigned char* begin = out;
+	*out++ = SNAPSHOT_DATAGRAM;
+	codec::put32(out, seq);
+	memcpy(out, reply.data(), reply.size());
+	return out - begin + reply.size();
+}
+
+inline bool UnpackSnapshotDatagram(const unsigned char* in, size_t size, uint32_t& seq, Packet& reply) {
+	if (size < 1 + 4 || in[0] != SNAPSHOT_DATAGRAM)
+		return false;
+	in++;
+	seq = codec::get32(in);
+	reply.assign(in, in + (size - 5));
+	return true;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include <cstdint>
+
+// Shared struct
+#include "Player.h"
+
+// The part of the local player the server has the last word on. Poses are the
+// client's own tracking and are never corrected; firing and dying are.
+struct LocalState {
+	bool fire;
+	bool dead;
+	MSGPACK_DEFINE_ARRAY(fire, dead)
+};
+
+// One frame of input applied to the local state. The server runs the same rule
+// on every tick and the client replays it over inputs the server has not seen,
+// so both end up in the same place when nothing was lost.
+inline void ApplyInput(LocalState& s, const Player& input) {
+	s.fire = input.fire && !s.dead;
+}
+
+// Client side prediction. Every frame's input gets a sequence number and is
+// applied at once; the inputs the server has not acknowledged yet are kept in a
+// ring. An authoritative state comes back with the number of the last input it
+// includes, and the newer inputs are replayed on top of it.
+class Predictor {
+public:
+	static const int SIZE = 256; // frames in flight, ~2.8 s at 90 Hz
+
+	Predictor() { reset(); }
+
+	void reset() {
+		head = 0;
+		acked = 0;
+		confirmed = { false, false };
+		current = confirmed;
+		corrections = 0;
+	}
+
+	// applies the input right away and returns its sequence number
+	uint32_t apply(const Player& input) {
+		uint32_t seq = ++head;
+		// a full ring drops the oldest input; the server has long since moved past it
+		inputs[seq % SIZE] = { seq, input.fire };
+		ApplyInput(current, input);
+		return seq;
+	}
+
+	// server state after input seq; 0 means the server applied none of ours yet
+	void reconcile(uint32_t seq, const LocalState& authoritative) {
+		if (seq < acked || seq > head)
+			return; // reordered, or from before a reset
+		acked = seq;
+		confirmed = authoritative;
+
+		LocalState replayed = confirmed;
+		uint32_t first = head - seq > SIZE ? head - SIZE + 1 : seq + 1;
+		for (uint32_t i = first; i <= head; i++) {
+			Player input = {};
+			input.fire = inputs[i % SIZE].fire;
+			ApplyInput(replayed, input);
+		}
+		if (replayed.fire != current.fire || replayed.dead != current.dead)
+			corrections++;
+		current = replayed;
+	}
+
+	const LocalState& predicted() const { return current; }
+	// inputs applied locally that the server has not confirmed
+	uint32_t pending() const { return head - acked; }
+	// times the prediction was wrong and had to be corrected
+	uint64_t mispredictions() const { return corrections; }
+
+private:
+	struct Entry {
+		uint32_t seq;
+		bool fire;
+	};
+
+	Entry inputs[SIZE];
+	uint32_t head;
+	uint32_t acked;
+	LocalState confirmed;
+	LocalState current;
+	uint64_t corrections;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <vector>
+
+// Shared struct
+#include "Player.h"
+#include "Prediction.h"
+
+// Messages shared by the client and the server beyond the Player struct itself.
+
+enum EventType {
+	EVENT_FIRED = 1, // the opponent pulled the trigger
+	EVENT_DIED = 2,  // the opponent was hit
+	EVENT_KILLED = 3 // the opponent hit you
+};
+
+// Something that happened to the opponent on the given server tick
+struct Event {
+	int type;
+	uint64_t tick;
+	MSGPACK_DEFINE_ARRAY(type, tick)
+};
+
+// Reply to "sync": everything the client needs for one frame in one round trip.
+// The client sends its own Player and the last tick it received; the server
+// answers with the opponent and the events the client has not seen yet, plus
+// the caller's own authoritative state for client side prediction (Prediction.h).
+struct SyncReply {
+	uint64_t tick;
+	double time;
+	bool opponent; // false while waiting for a second player
+	Player other;
+	uint32_t inputSeq; // last input of the caller's that self includes, 0 for none
+	LocalState self;
+	std::vector<Event> events;
+	MSGPACK_DEFINE_ARRAY(tick, time, opponent, other, inputSeq, self, events)
+};
+
+// Argument of "shoot": a shot in the shooter's tracking space, the match time
+// the trigger was pulled (synced through "clock") and the match time of the
+// opponent pose the shooter was looking at then. The server rewinds the
+// opponent to that time to decide whether it hit.
+struct Shot {
+	double firedAt;
+	double viewTime;
+	glm::vec3 origin;
+	glm::vec3 direction;
+	MSGPACK_DEFINE_ARRAY(firedAt, viewTime, origin.x, origin.y, origin.z, direction.x, direction.y, direction.z)
+};
+
+// Reply to "clock": the match clock as the server answered, for ClockSync.h,
+// and when the duel starts on that clock (0 until both seats are taken)
+struct ClockReply {
+	double time;
+	double startAt;
+	MSGPACK_DEFINE_ARRAY(time, startAt)
+};
+
+// Reply to "events": the reliable half of the pose channel (PoseChannel.h).
+// Same events as in SyncReply, newer than the tick the client passed in.
+struct EventReply {
+	uint64_t tick;
+	std::vector<Event> events;
+	// Seat::seating of the caller; a new value means the session was seated
+	// again, after being reaped or moved to another match, and tick and events
+	// belong to that match
+	uint32_t seating;
+	MSGPACK_DEFINE_ARRAY(tick, events, seating)
+};
+
+// Reply to "udp_token": where to send pose datagrams and the token to tag them with
+struct PoseTicket {
+	uint32_t token; // 0 when the server has no pose channel
+	uint16_t port;
+	MSGPACK_DEFINE_ARRAY(token, port)
+};
+
+#endif
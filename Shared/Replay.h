@@ -0,0 +1,160 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <cstring>
+
+// Shared struct
+#include "Player.h"
+#include "PlayerCodec.h"
+
+// Replay file of one match, written by the server (Server/ReplayRecorder.h) and
+// read back through ReplayReader.h. Append-only, little endian:
+//   file header   24 bytes
+//   chunks        chunk header (24 bytes) + count fixed-size tick records
+//   index         one entry per chunk, written when the recording is closed
+//   trailer       16 bytes at the very end, pointing at the index
+// A file without a trailer (the server died) is still readable: the reader
+// walks the chunks from the front and stops at the first incomplete one.
+//
+// Tick record, REPLAY_RECORD_SIZE bytes:
+//   u32 tick, f64 time, u8 flags (fired / died this tick, per slot),
+//   2 x packed player (PlayerCodec.h), 2 x u32 input seq
+
+namespace replay
+{
+	const uint32_t FILE_MAGIC = 0x50524457;  // "WDRP"
+	const uint32_t CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+	const uint32_t INDEX_MAGIC = 0x58494457; // "WDIX"
+	const uint16_t VERSION = 1;
+
+	const size_t FILE_HEADER_SIZE = 24;
+	const size_t CHUNK_HEADER_SIZE = 24;
+	const size_t INDEX_ENTRY_SIZE = 16;
+	const size_t TRAILER_SIZE = 16;
+
+	enum Flags {
+		FIRED_0 = 1, FIRED_1 = 2,
+		DIED_0 = 4, DIED_1 = 8
+	};
+
+	inline void put64(unsigned char*& out, uint64_t v) {
+		codec::put32(out, (uint32_t)v);
+		codec::put32(out, (uint32_t)(v >> 32));
+	}
+
+	inline uint64_t get64(const unsigned char*& in) {
+		uint64_t lo = codec::get32(in);
+		return lo | ((uint64_t)codec::get32(in) << 32);
+	}
+
+	inline void putDouble(unsigned char*& out, double v) {
+		uint64_t bits;
+		std::memcpy(&bits, &v, 8);
+		put64(out, bits);
+	}
+
+	inline double getDouble(const unsigned char*& in) {
+		uint64_t bits = get64(in);
+		double v;
+		std::memcpy(&v, &bits, 8);
+		return v;
+	}
+}
+
+const size_t REPLAY_RECORD_SIZE = 4 + 8 + 1 + 2 * PACKED_PLAYER_SIZE + 2 * 4;
+
+// One tick of a match as recorded
+struct ReplayTick {
+	uint64_t tick;
+	double time;
+	Player players[2];
+	uint32_t inputSeq[2];
+	bool fired[2]; // the player pulled the trigger on this tick
+	bool died[2];  // the player was hit on this tick
+};
+
+// Describes the whole file
+struct ReplayHeader {
+	uint32_t match;
+	uint64_t startedAt; // unix time the recording began
+};
+
+// Describes one chunk
+struct ReplayChunk {
+	uint32_t firstTick;
+	uint32_t count;
+	double startAt; // the match's start signal as of the end of the chunk, 0 if not given yet
+	uint64_t offset; // of the chunk header in the file
+};
+
+// writes exactly REPLAY_RECORD_SIZE bytes
+inline void PackReplayTick(const ReplayTick& t, unsigned char* out) {
+	codec::put32(out, (uint32_t)t.tick);
+	replay::putDouble(out, t.time);
+	*out++ = (unsigned char)((t.fired[0] ? replay::FIRED_0 : 0) | (t.fired[1] ? replay::FIRED_1 : 0)
+		| (t.died[0] ? replay::DIED_0 : 0) | (t.died[1] ? replay::DIED_1 : 0));
+	for (int i = 0; i < 2; i++) {
+		PackPlayer(t.players[i], out);
+		out += PACKED_PLAYER_SIZE;
+	}
+	for (int i = 0; i < 2; i++)
+		codec::put32(out, t.inputSeq[i]);
+}
+
+// reads exactly REPLAY_RECORD_SIZE bytes
+inline void UnpackReplayTick(const unsigned char* in, ReplayTick& t) {
+	t.tick = codec::get32(in);
+	t.time = replay::getDouble(in);
+	unsigned char flags = *in++;
+	t.fired[0] = (flags & replay::FIRED_0) != 0;
+	t.fired[1] = (flags & replay::FIRED_1) != 0;
+	t.died[0] = (flags & replay::DIED_0) != 0;
+	t.died[1] = (flags & replay::DIED_1) != 0;
+	for (int i = 0; i < 2; i++) {
+		UnpackPlayer(in, t.players[i]);
+		in += PACKED_PLAYER_SIZE;
+	}
+	for (int i = 0; i < 2; i++)
+		t.inputSeq[i] = codec::get32(in);
+}
+
+inline void PackReplayHeader(const ReplayHeader& h, unsigned char* out) {
+	codec::put32(out, replay::FILE_MAGIC);
+	codec::put16(out, replay::VERSION);
+	codec::put16(out, (uint16_t)REPLAY_RECORD_SIZE);
+	codec::put32(out, h.match);
+	codec::put32(out, 0);
+	replay::put64(out, h.startedAt);
+}
+
+inline bool UnpackReplayHeader(const unsigned char* in, ReplayHeader& h) {
+	if (codec::get32(in) != replay::FILE_MAGIC || codec::get16(in) != replay::VERSION || codec::get16(in) != REPLAY_RECORD_SIZE)
+		return false;
+	h.match = codec::get32(in);
+	codec::get32(in);
+	h.startedAt = replay::get64(in);
+	return true;
+}
+
+// chunk header; offset is not stored, it is where the header is
+inline void PackReplayChunk(const ReplayChunk& c, unsigned char* out) {
+	codec::put32(out, replay::CHUNK_MAGIC);
+	codec::put32(out, c.firstTick);
+	codec::put32(out, c.count);
+	codec::put32(out, (uint32_t)(c.count * REPLAY_RECORD_SIZE));
+	replay::putDouble(out, c.startAt);
+}
+
+inline bool UnpackReplayChunk(const unsigned char* in, ReplayChunk& c) {
+	if (codec::get32(in) != replay::CHUNK_MAGIC)
+		return false;
+	c.firstTick = codec::get32(in);
+	c.count = codec::get32(in);
+	if (codec::get32(in) != c.count * REPLAY_RECORD_SIZE)
+		return false;
+	c.startAt = replay::getDouble(in);
+	return true;
+}
+
+#endif
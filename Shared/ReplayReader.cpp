@@ -0,0 +1,164 @@
+#include "ReplayReader.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+static const intptr_t NO_HANDLE = (intptr_t)INVALID_HANDLE_VALUE;
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+static const intptr_t NO_HANDLE = -1;
+#endif
+
+ReplayReader::ReplayReader() : data(nullptr), length(0), file(NO_HANDLE), mapping(NO_HANDLE), head(), hasIndex(false) {
+}
+
+ReplayReader::~ReplayReader() {
+	close();
+}
+
+bool ReplayReader::open(const char* path) {
+	close();
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	file = (intptr_t)f;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(f, &size) || size.QuadPart < (LONGLONG)replay::FILE_HEADER_SIZE) {
+		close();
+		return false;
+	}
+	length = (size_t)size.QuadPart;
+	HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m) {
+		close();
+		return false;
+	}
+	mapping = (intptr_t)m;
+	data = (const unsigned char*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+#else
+	int f = ::open(path, O_RDONLY);
+	if (f < 0)
+		return false;
+	file = f;
+	struct stat st;
+	if (fstat(f, &st) != 0 || st.st_size < (off_t)replay::FILE_HEADER_SIZE) {
+		close();
+		return false;
+	}
+	length = (size_t)st.st_size;
+	void* view = mmap(nullptr, length, PROT_READ, MAP_SHARED, f, 0);
+	data = view == MAP_FAILED ? nullptr : (const unsigned char*)view;
+#endif
+	if (!data || !UnpackReplayHeader(data, head)) {
+		close();
+		return false;
+	}
+	hasIndex = readIndex();
+	if (!hasIndex)
+		scanChunks();
+	return true;
+}
+
+void ReplayReader::close() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping != NO_HANDLE)
+		CloseHandle((HANDLE)mapping);
+	if (file != NO_HANDLE)
+		CloseHandle((HANDLE)file);
+#else
+	if (data)
+		munmap((void*)data, length);
+	if (file != NO_HANDLE)
+		::close((int)file);
+#endif
+	data = nullptr;
+	length = 0;
+	file = NO_HANDLE;
+	mapping = NO_HANDLE;
+	hasIndex = false;
+	index.clear();
+}
+
+size_t ReplayReader::ticks() const {
+	size_t n = 0;
+	for (const ReplayChunk& c : index)
+		n += c.count;
+	return n;
+}
+
+double ReplayReader::startAt() const {
+	for (auto it = index.rbegin(); it != index.rend(); ++it) {
+		if (it->startAt != 0.0)
+			return it->startAt;
+	}
+	return 0.0;
+}
+
+bool ReplayReader::at(uint64_t tick, ReplayTick& out) const {
+	// last chunk starting at or before tick
+	auto it = std::upper_bound(index.begin(), index.end(), tick,
+		[](uint64_t t, const ReplayChunk& c) { return t < c.firstTick; });
+	if (it == index.begin())
+		return false;
+	--it;
+	if (tick >= (uint64_t)it->firstTick + it->count)
+		return false;
+	size_t record = (size_t)(tick - it->firstTick);
+	UnpackReplayTick(data + it->offset + replay::CHUNK_HEADER_SIZE + record * REPLAY_RECORD_SIZE, out);
+	return true;
+}
+
+// The trailer points at the index; every entry is checked against the chunk it names
+bool ReplayReader::readIndex() {
+	if (length < replay::FILE_HEADER_SIZE + replay::TRAILER_SIZE)
+		return false;
+	const unsigned char* in = data + length - replay::TRAILER_SIZE;
+	uint64_t indexOffset = replay::get64(in);
+	uint32_t entries = codec::get32(in);
+	if (codec::get32(in) != replay::INDEX_MAGIC)
+		return false;
+	if (indexOffset < replay::FILE_HEADER_SIZE || indexOffset + (uint64_t)entries * replay::INDEX_ENTRY_SIZE != length - replay::TRAILER_SIZE)
+		return false;
+
+	in = data + indexOffset;
+	for (uint32_t i = 0; i < entries; i++) {
+		ReplayChunk entry;
+		entry.firstTick = codec::get32(in);
+		entry.count = codec::get32(in);
+		entry.offset = replay::get64(in);
+		ReplayChunk c;
+		if (entry.offset + replay::CHUNK_HEADER_SIZE + (uint64_t)entry.count * REPLAY_RECORD_SIZE > indexOffset
+			|| !UnpackReplayChunk(data + entry.offset, c) || c.firstTick != entry.firstTick || c.count != entry.count) {
+			index.clear();
+			return false;
+		}
+		c.offset = entry.offset;
+		index.push_back(c);
+	}
+	return true;
+}
+
+// Recovery for recordings that were never closed
+void ReplayReader::scanChunks() {
+	index.clear();
+	uint64_t offset = replay::FILE_HEADER_SIZE;
+	while (offset + replay::CHUNK_HEADER_SIZE <= length) {
+		ReplayChunk c;
+		if (!UnpackReplayChunk(data + offset, c))
+			break;
+		uint64_t end = offset + replay::CHUNK_HEADER_SIZE + (uint64_t)c.count * REPLAY_RECORD_SIZE;
+		if (end > length)
+			break;
+		c.offset = offset;
+		index.push_back(c);
+		offset = end;
+	}
+}
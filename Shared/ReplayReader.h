@@ -0,0 +1,52 @@
+#ifndef REPLAYREADER_H
+#define REPLAYREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Replay.h"
+
+// Random access to a replay file (Replay.h) by tick. The file is memory mapped
+// and only the index is read up front, so opening a long match costs nothing
+// and at() decodes the one record asked for. The platform headers stay in
+// ReplayReader.cpp.
+class ReplayReader {
+public:
+	ReplayReader();
+	~ReplayReader();
+	ReplayReader(const ReplayReader&) = delete;
+	ReplayReader& operator=(const ReplayReader&) = delete;
+
+	bool open(const char* path);
+	void close();
+
+	const ReplayHeader& header() const { return head; }
+	// false if the trailer was missing and the chunks were found by walking the file
+	bool indexed() const { return hasIndex; }
+	const std::vector<ReplayChunk>& chunks() const { return index; }
+
+	size_t ticks() const;
+	uint64_t firstTick() const { return index.empty() ? 0 : index.front().firstTick; }
+	uint64_t lastTick() const { return index.empty() ? 0 : index.back().firstTick + index.back().count - 1; }
+	// the start signal as last recorded, 0 if the duel never started
+	double startAt() const;
+
+	// false if the tick was not recorded
+	bool at(uint64_t tick, ReplayTick& out) const;
+
+private:
+	bool readIndex();
+	void scanChunks();
+
+	const unsigned char* data;
+	size_t length;
+	intptr_t file;
+	intptr_t mapping;
+
+	ReplayHeader head;
+	bool hasIndex;
+	std::vector<ReplayChunk> index; // ordered by tick
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SERVERSTATS_H
+#define SERVERSTATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rpc/msgpack.hpp"
+
+// Reply to "stats": the server's instrumentation (Server/Metrics.h) at one moment.
+// Counters run from server start; latencies are in microseconds.
+
+struct LatencySummary {
+	uint64_t count;
+	double mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+	MSGPACK_DEFINE_ARRAY(count, mean, p50, p90, p99, p999, max)
+};
+
+// One rpc, or "pose_datagram" for the udp pose channel
+struct RpcStats {
+	std::string name;
+	uint64_t calls;
+	uint64_t bytesIn;  // payload only, for the calls that carry packed bytes
+	uint64_t bytesOut;
+	LatencySummary latency;
+	MSGPACK_DEFINE_ARRAY(name, calls, bytesIn, bytesOut, latency)
+};
+
+struct ShardTickStats {
+	int index;
+	uint64_t matches;
+	uint64_t ticks;
+	uint64_t dropped;
+	double utilization;
+	LatencySummary tick; // time spent in one tick
+	MSGPACK_DEFINE_ARRAY(index, matches, ticks, dropped, utilization, tick)
+};
+
+struct SessionTraffic {
+	int64_t session;
+	uint64_t calls;
+	uint64_t bytesIn;
+	uint64_t bytesOut;
+	MSGPACK_DEFINE_ARRAY(session, calls, bytesIn, bytesOut)
+};
+
+struct ServerStats {
+	double uptime;      // seconds
+	uint64_t sessions;  // seated
+	uint64_t matches;
+	int64_t inFlight;   // handlers running when the stats were taken
+	std::vector<RpcStats> rpcs;
+	std::vector<ShardTickStats> shards;
+	std::vector<SessionTraffic> traffic; // the busiest sessions by bytes
+	MSGPACK_DEFINE_ARRAY(uptime, sessions, matches, inFlight, rpcs, shards, traffic)
+};
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef SNAPSHOTDELTA_H
+#define SNAPSHOTDELTA_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "PlayerCodec.h"
+
+// Delta encoding of packed players (PlayerCodec.h) against a baseline both
+// sides still have. The packed layout is split into 16 components: the flag
+// byte, the three 32 bit quaternions and the twelve 16 bit vector components.
+// A delta is a 16 bit mask of the components that differ from the baseline,
+// followed by those components as they appear in the packed layout. Without a
+// baseline every component is sent, which costs two bytes over PackPlayer.
+// Comparing quantized bytes keeps both sides bit-identical, so deltas never drift.
+
+namespace delta
+{
+	const int COMPONENTS = 16;
+	const size_t MAX_SIZE = 2 + PACKED_PLAYER_SIZE;
+
+	// offset and size of every component in the packed layout
+	inline size_t offset(int c) {
+		return c == 0 ? 0 : c <= 3 ? 1 + (c - 1) * 4 : 13 + (c - 4) * 2;
+	}
+	inline size_t size(int c) {
+		return c == 0 ? 1 : c <= 3 ? 4 : 2;
+	}
+}
+
+// Writes the delta of cur against base (nullptr for none) to out, which must
+// hold delta::MAX_SIZE bytes. Returns the number of bytes written.
+inline size_t PackDelta(const unsigned char* base, const unsigned char* cur, unsigned char* out) {
+	uint16_t mask = 0;
+	for (int c = 0; c < delta::COMPONENTS; c++) {
+		if (!base || memcmp(base + delta::offset(c), cur + delta::offset(c), delta::size(c)) != 0)
+			mask |= 1 << c;
+	}
+	unsigned char* begin = out;
+	codec::put16(out, mask);
+	for (int c = 0; c < delta::COMPONENTS; c++) {
+		if (mask & (1 << c)) {
+			memcpy(out, cur + delta::offset(c), delta::size(c));
+			out += delta::size(c);
+		}
+	}
+	return out - begin;
+}
+
+// Rebuilds the packed player in cur from base (nullptr for none) and the delta
+// at in, advancing in past it. Fails if the delta runs past end or needs a
+// baseline that was not given.
+inline bool UnpackDelta(const unsigned char* base, const unsigned char*& in, const unsigned char* end, unsigned char* cur) {
+	if (end - in < 2)
+		return false;
+	uint16_t mask = codec::get16(in);
+	if (!base && mask != 0xFFFF)
+		return false;
+	for (int c = 0; c < delta::COMPONENTS; c++) {
+		size_t n = delta::size(c);
+		if (mask & (1 << c)) {
+			if ((size_t)(end - in) < n)
+				return false;
+			memcpy(cur + delta::offset(c), in, n);
+			in += n;
+		}
+		else {
+			memcpy(cur + delta::offset(c), base + delta::offset(c), n);
+		}
+	}
+	return true;
+}
+
+// The last few packed players sent (server) or received (client), by tick.
+// Tick 0 is never stored; it means "no baseline".
+class SnapshotRing {
+public:
+	static const int SIZE = 32; // ~0.25 s of sync calls at 120 Hz
+
+	SnapshotRing() { clear(); }
+
+	void clear() {
+		for (Entry& e : entries)
+			e.tick = 0;
+		next = 0;
+	}
+
+	void store(uint32_t tick, const unsigned char* packed) {
+		if (tick == 0)
+			return;
+		Entry& e = entries[next];
+		next = (next + 1) % SIZE;
+		e.tick = tick;
+		memcpy(e.packed, packed, PACKED_PLAYER_SIZE);
+	}
+
+	// packed player stored for tick, or nullptr if it has been overwritten
+	const unsigned char* find(uint32_t tick) const {
+		if (tick == 0)
+			return nullptr;
+		for (int i = 1; i <= SIZE; i++) {
+			const Entry& e = entries[(next - i + SIZE) % SIZE];
+			if (e.tick == tick)
+				return e.packed;
+		}
+		return nullptr;
+	}
+
+private:
+	struct Entry {
+		uint32_t tick;
+		unsigned char packed[PACKED_PLAYER_SIZE];
+	};
+	Entry entries[SIZE];
+	int next;
+};
+
+// "sync_delta" request: packed player, u32 last tick seen (for events),
+// u32 tick of the newest reply the client decoded (the baseline it acknowledges),
+// u32 sequence number of the input the player belongs to
+inline Packet PackDeltaSyncRequest(const Player& p, uint64_t lastTick, uint32_t ackTick, uint32_t inputSeq) {
+	Packet packet(PACKED_PLAYER_SIZE + 12);
+	PackPlayer(p, &packet[0]);
+	unsigned char* out = &packet[PACKED_PLAYER_SIZE];
+	codec::put32(out, (uint32_t)lastTick);
+	codec::put32(out, ackTick);
+	codec::put32(out, inputSeq);
+	return packet;
+}
+
+inline bool UnpackDeltaSyncRequest(const Packet& packet, Player& p, uint64_t& lastTick, uint32_t& ackTick, uint32_t& inputSeq) {
+	if (packet.size() < PACKED_PLAYER_SIZE + 12)
+		return false;
+	UnpackPlayer(&packet[0], p);
+	const unsigned char* in = &packet[PACKED_PLAYER_SIZE];
+	lastTick = codec::get32(in);
+	ackTick = codec::get32(in);
+	inputSeq = codec::get32(in);
+	return true;
+}
+
+// "sync_delta" reply: u32 tick, u32 baseline tick (0 = none), f32 time,
+// u8 opponent, u32 input seq, u8 own state (bit 0 fire, bit 1 dead), player delta,
+// u8 event count, then u8 type + u32 tick per event.
+// history supplies the baseline and records what was sent.
+inline Packet PackDeltaSyncReply(const SyncReply& reply, uint32_t ackTick, SnapshotRing& history) {
+	unsigned char cur[PACKED_PLAYER_SIZE];
+	PackPlayer(reply.other, cur);
+	const unsigned char* base = history.find(ackTick);
+	history.store((uint32_t)reply.tick, cur);
+
+	size_t events = std::min<size_t>(reply.events.size(), 255);
+	Packet packet(4 + 4 + 4 + 1 + 5 + delta::MAX_SIZE + 1 + events * 5);
+	unsigned char* out = &packet[0];
+	codec::put32(out, (uint32_t)reply.tick);
+	codec::put32(out, base ? ackTick : 0);
+	float time = (float)reply.time;
+	uint32_t timeBits;
+	memcpy(&timeBits, &time, 4);
+	codec::put32(out, timeBits);
+	*out++ = reply.opponent ? 1 : 0;
+	codec::put32(out, reply.inputSeq);
+	*out++ = (reply.self.fire ? 1 : 0) | (reply.self.dead ? 2 : 0);
+	out += PackDelta(base, cur, out);
+	*out++ = (unsigned char)events;
+	for (size_t i = 0; i < events; i++) {
+		*out++ = (unsigned char)reply.events[i].type;
+		codec::put32(out, (uint32_t)reply.events[i].tick);
+	}
+	packet.resize(out - &packet[0]);
+	return packet;
+}
+
+// history supplies the baseline and records the rebuilt player
+inline bool UnpackDeltaSyncReply(const Packet& packet, SyncReply& reply, SnapshotRing& history) {
+	if (packet.size() < 4 + 4 + 4 + 1 + 5 + 2 + 1)
+		return false;
+	const unsigned char* in = &packet[0];
+	const unsigned char* end = in + packet.size();
+	reply.tick = codec::get32(in);
+	uint32_t baseTick = codec::get32(in);
+	uint32_t timeBits = codec::get32(in);
+	float time;
+	memcpy(&time, &timeBits, 4);
+	reply.time = time;
+	reply.opponent = *in++ != 0;
+	reply.inputSeq = codec::get32(in);
+	reply.self.fire = (*in & 1) != 0;
+	reply.self.dead = (*in & 2) != 0;
+	in++;
+
+	const unsigned char* base = history.find(baseTick);
+	if (baseTick != 0 && !base)
+		return false;
+	unsigned char cur[PACKED_PLAYER_SIZE];
+	if (!UnpackDelta(base, in, end, cur) || in == end)
+		return false;
+	UnpackPlayer(cur, reply.other);
+
+	size_t events = *in++;
+	if ((size_t)(end - in) < events * 5)
+		return false;
+	reply.events.resize(events);
+	for (size_t i = 0; i < events; i++) {
+		reply.events[i].type = *in++;
+		reply.events[i].tick = codec::get32(in);
+	}
+	history.store((uint32_t)reply.tick, cur);
+	return true;
+}
+
+#endif
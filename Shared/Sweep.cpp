@@ -0,0 +1,81 @@
+#include "Sweep.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SWEEP_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Slab test: the segment is inside the box over the part of [0, 1] that is
+// inside all three slabs
+bool SweepBox(const glm::vec3& from, const glm::vec3& to, const glm::vec3& lo, const glm::vec3& hi, float& toi) {
+	glm::vec3 d = to - from;
+	float enter = 0.0f;
+	float leave = 1.0f;
+	for (int axis = 0; axis < 3; axis++) {
+		float inv = SlabInverse(d[axis]);
+		float t1 = (lo[axis] - from[axis]) * inv;
+		float t2 = (hi[axis] - from[axis]) * inv;
+		enter = std::max(enter, std::min(t1, t2));
+		leave = std::min(leave, std::max(t1, t2));
+	}
+	if (enter > leave)
+		return false;
+	toi = enter;
+	return true;
+}
+
+#ifdef SWEEP_SSE
+static inline void Slab(__m128 lo, __m128 hi, __m128 origin, __m128 inv, __m128& enter, __m128& leave) {
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(lo, origin), inv);
+	__m128 t2 = _mm_mul_ps(_mm_sub_ps(hi, origin), inv);
+	enter = _mm_max_ps(enter, _mm_min_ps(t1, t2));
+	leave = _mm_min_ps(leave, _mm_max_ps(t1, t2));
+}
+#endif
+
+void SweepBatch(const glm::vec3* from, const glm::vec3* to, size_t segments, const SweepTargets& targets, std::vector<SweepHit>& hits) {
+	size_t n = targets.size();
+	for (size_t s = 0; s < segments; s++) {
+		glm::vec3 d = to[s] - from[s];
+		glm::vec3 inv(SlabInverse(d.x), SlabInverse(d.y), SlabInverse(d.z));
+		float best = 2.0f;
+		size_t hit = n;
+		size_t i = 0;
+#ifdef SWEEP_SSE
+		__m128 ox = _mm_set1_ps(from[s].x), oy = _mm_set1_ps(from[s].y), oz = _mm_set1_ps(from[s].z);
+		__m128 ix = _mm_set1_ps(inv.x), iy = _mm_set1_ps(inv.y), iz = _mm_set1_ps(inv.z);
+		for (; i + 4 <= n; i += 4) {
+			__m128 enter = _mm_setzero_ps();
+			__m128 leave = _mm_set1_ps(1.0f);
+			Slab(_mm_loadu_ps(&targets.loX[i]), _mm_loadu_ps(&targets.hiX[i]), ox, ix, enter, leave);
+			Slab(_mm_loadu_ps(&targets.loY[i]), _mm_loadu_ps(&targets.hiY[i]), oy, iy, enter, leave);
+			Slab(_mm_loadu_ps(&targets.loZ[i]), _mm_loadu_ps(&targets.hiZ[i]), oz, iz, enter, leave);
+			// only hits that come before the best so far
+			int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(enter, leave), _mm_cmplt_ps(enter, _mm_set1_ps(best))));
+			if (!mask)
+				continue;
+			float t[4];
+			_mm_storeu_ps(t, enter);
+			for (int lane = 0; lane < 4; lane++) {
+				if ((mask & (1 << lane)) && t[lane] < best) {
+					best = t[lane];
+					hit = i + lane;
+				}
+			}
+		}
+#endif
+		for (; i < n; i++) {
+			float toi;
+			if (SweepBox(from[s], to[s], glm::vec3(targets.loX[i], targets.loY[i], targets.loZ[i]),
+				glm::vec3(targets.hiX[i], targets.hiY[i], targets.hiZ[i]), toi) && toi < best) {
+				best = toi;
+				hit = i;
+			}
+		}
+		if (hit < n)
+			hits.push_back({ (uint32_t)s, (uint32_t)hit, best });
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Aabb.h"
+
+// Continuous collision for things that move far in one step, like bullets.
+// The segment a projectile covered during the step is tested against the
+// target's box, so it cannot step over a target thinner than its stride the
+// way an overlap test at each step's end does. A hit comes with its time of
+// impact, 0 at the start of the segment and 1 at its end.
+
+// One segment against one box; a segment starting inside the box hits at 0
+bool SweepBox(const glm::vec3& from, const glm::vec3& to, const glm::vec3& lo, const glm::vec3& hi, float& toi);
+
+// World boxes, one component per array so the batch test takes four of them
+// per SSE instruction. Built once per tick, e.g. by TransformAabbs; hits refer
+// to the boxes by index.
+typedef AabbSoA SweepTargets;
+
+struct SweepHit {
+	uint32_t segment;
+	uint32_t target;
+	float toi;
+};
+
+// Every segment from[i] -> to[i] against every target. Appends the first target
+// each segment reaches, if any, to hits.
+void SweepBatch(const glm::vec3* from, const glm::vec3* to, size_t segments, const SweepTargets& targets, std::vector<SweepHit>& hits);
+
+#endif
@@ -0,0 +1,157 @@
+#include "UdpSocket.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+static const intptr_t NO_SOCKET = (intptr_t)INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+static const intptr_t NO_SOCKET = -1;
+#endif
+
+namespace
+{
+	// Winsock has to be started once per process before any socket call
+	struct SocketInit {
+		SocketInit() {
+#ifdef _WIN32
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+		}
+		~SocketInit() {
+#ifdef _WIN32
+			WSACleanup();
+#endif
+		}
+	};
+
+	void initSockets() {
+		static SocketInit init;
+	}
+
+	sockaddr_in toSockaddr(const UdpAddress& a) {
+		sockaddr_in s;
+		memset(&s, 0, sizeof(s));
+		s.sin_family = AF_INET;
+		s.sin_addr.s_addr = htonl(a.ip);
+		s.sin_port = htons(a.port);
+		return s;
+	}
+
+	void closeHandle(intptr_t h) {
+#ifdef _WIN32
+		closesocket((SOCKET)h);
+#else
+		::close((int)h);
+#endif
+	}
+}
+
+UdpSocket::UdpSocket() : handle(NO_SOCKET) {
+	initSockets();
+}
+
+UdpSocket::~UdpSocket() {
+	close();
+}
+
+bool UdpSocket::open(uint16_t port) {
+	close();
+	intptr_t h = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (h == NO_SOCKET)
+		return false;
+	UdpAddress any = { 0, port };
+	sockaddr_in addr = toSockaddr(any);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(h, (sockaddr*)&addr, sizeof(addr)) != 0) {
+		closeHandle(h);
+		return false;
+	}
+	handle = h;
+	return true;
+}
+
+void UdpSocket::close() {
+	if (handle != NO_SOCKET) {
+		closeHandle(handle);
+		handle = NO_SOCKET;
+	}
+}
+
+bool UdpSocket::isOpen() const {
+	return handle != NO_SOCKET;
+}
+
+uint16_t UdpSocket::localPort() const {
+	sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	if (handle == NO_SOCKET || getsockname(handle, (sockaddr*)&addr, &len) != 0)
+		return 0;
+	return ntohs(addr.sin_port);
+}
+
+bool UdpSocket::resolve(const char* host, uint16_t port, UdpAddress& out) {
+	initSockets();
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result)
+		return false;
+	out.ip = ntohl(((sockaddr_in*)result->ai_addr)->sin_addr.s_addr);
+	out.port = port;
+	freeaddrinfo(result);
+	return true;
+}
+
+bool UdpSocket::sendTo(const UdpAddress& to, const void* data, size_t size) {
+	if (handle == NO_SOCKET)
+		return false;
+	sentCount++;
+	if (loss > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) < loss) {
+		droppedCount++;
+		return true;
+	}
+	sockaddr_in addr = toSockaddr(to);
+	return sendto(handle, (const char*)data, (int)size, 0, (sockaddr*)&addr, sizeof(addr)) == (int)size;
+}
+
+int UdpSocket::receiveFrom(UdpAddress& from, void* data, size_t capacity, int timeoutMs) {
+	if (handle == NO_SOCKET)
+		return -1;
+#ifdef _WIN32
+	WSAPOLLFD pfd = { (SOCKET)handle, POLLRDNORM, 0 };
+	int ready = WSAPoll(&pfd, 1, timeoutMs);
+#else
+	pollfd pfd = { (int)handle, POLLIN, 0 };
+	int ready = poll(&pfd, 1, timeoutMs);
+#endif
+	if (ready <= 0)
+		return ready;
+
+	sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int n = (int)recvfrom(handle, (char*)data, (int)capacity, 0, (sockaddr*)&addr, &len);
+#ifdef _WIN32
+	// an ICMP port unreachable from an earlier send shows up here on Windows
+	if (n < 0 && WSAGetLastError() == WSAECONNRESET)
+		return 0;
+#endif
+	if (n < 0)
+		return -1;
+	from.ip = ntohl(addr.sin_addr.s_addr);
+	from.port = ntohs(addr.sin_port);
+	receivedCount++;
+	return n;
+}
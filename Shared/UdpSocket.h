@@ -0,0 +1,55 @@
+#ifndef UDPSOCKET_H
+#define UDPSOCKET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// IPv4 address and port, both in host byte order
+struct UdpAddress {
+	uint32_t ip;
+	uint16_t port;
+
+	bool operator==(const UdpAddress& o) const { return ip == o.ip && port == o.port; }
+};
+
+// Minimal blocking UDP socket over Winsock or BSD sockets. The platform headers
+// stay in UdpSocket.cpp so including this next to <Windows.h> is safe.
+// setLoss() drops the given fraction of outgoing datagrams on purpose, to test
+// the pose channel on loopback.
+class UdpSocket {
+public:
+	UdpSocket();
+	~UdpSocket();
+	UdpSocket(const UdpSocket&) = delete;
+	UdpSocket& operator=(const UdpSocket&) = delete;
+
+	// bind to port on every interface; 0 picks any free port
+	bool open(uint16_t port = 0);
+	void close();
+	bool isOpen() const;
+	uint16_t localPort() const;
+
+	static bool resolve(const char* host, uint16_t port, UdpAddress& out);
+
+	// false on error; a datagram dropped by setLoss() still counts as sent
+	bool sendTo(const UdpAddress& to, const void* data, size_t size);
+	// size of the datagram received, 0 on timeout, -1 on error
+	int receiveFrom(UdpAddress& from, void* data, size_t capacity, int timeoutMs);
+
+	void setLoss(double fraction) { loss = fraction; }
+	uint64_t sent() const { return sentCount.load(); }
+	uint64_t dropped() const { return droppedCount.load(); }
+	uint64_t received() const { return receivedCount.load(); }
+
+private:
+	intptr_t handle;
+	double loss = 0.0;
+	std::mt19937 rng{ 1234 };
+	std::atomic<uint64_t> sentCount{ 0 };
+	std::atomic<uint64_t> droppedCount{ 0 };
+	std::atomic<uint64_t> receivedCount{ 0 };
+};
+
+#endif